@@ -8,6 +8,14 @@
 #error "Unsupported RISC-V architecture. Only 32-bit and 64-bit are supported."
 #endif
 
+// Same as in types.h, so assembly sources see the SMP configuration.
+#if _NUM_HARTS > 1
+#define SMP
+#endif
+#if _MULTIKERNEL
+#define MULTIKERNEL
+#endif
+
 #define OFFSET_SIZE _X(4, 8) ///< Offset size for 32-bit and 64-bit architectures.
 #define LREG _X(lw, ld)	     ///< Load register instruction for 32-bit and 64-bit architectures.
 #define SREG _X(sw, sd)	     ///< Store register instruction for 32-bit and 64-bit architectures.
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "types.h"
+
+/**
+ * A memory capability derived for a channel and its PMP configuration.
+ */
+typedef struct chan_map {
+	word_t slot; ///< PMP slot, 0 to leave the capability unmapped.
+	word_t mode; ///< PMP mode, as for mem_pmp_set, the permissions are those of the capability.
+	word_t addr; ///< PMP address, the bottom address for TOR.
+	word_t top;  ///< PMP top address for TOR.
+	word_t mem; ///< Receives the index of the memory capability.
+} chan_map_t;
+
+/**
+ * One end of a shared-memory channel, a process monitored by the caller.
+ */
+typedef struct chan_end {
+	word_t mon;     ///< Index of the caller's monitor capability of the process.
+	chan_map_t buf; ///< The buffer, read-write for the producer and read-only for the consumer.
+	word_t ipc;     ///< Receives the index of the notification capability, the source or the sink.
+} chan_end_t;
+
+/**
+ * Descriptor of a shared-memory channel, read from and written back to the caller's memory.
+ * All words, so the layout is the same for the kernel and the library.
+ */
+typedef struct chan {
+	word_t mem;      ///< Index of the caller's memory capability to derive the buffer from.
+	word_t base;     ///< Base address of the buffer.
+	word_t size;     ///< Size of the buffer.
+	word_t ipc;      ///< Index of the caller's IPC capability to derive the notification sink from.
+	word_t badge;    ///< Badge of the producer's notification source.
+	chan_end_t prod; ///< The producer.
+	chan_end_t cons; ///< The consumer.
+	word_t ack_size; ///< Size of the consumer's read-write region at the start of the buffer, 0 for none.
+	chan_map_t ack;  ///< The region, its PMP slot must be below the consumer's slot of the buffer.
+} chan_t;
+
+/**
+ * Establishes a shared-memory channel between two processes in a single operation.
+ *
+ * Derives a read-write memory capability of the buffer for the producer and a read-only
+ * one for the consumer, and optionally a read-write capability of the start of the buffer
+ * for the consumer to publish its progress. Maps them in the PMP slots of the descriptor.
+ * Derives a notification sink for the consumer with a source for the producer. If a step
+ * fails, the steps before it are undone and their fuel is reclaimed.
+ *
+ * @param owner The process ID of the caller.
+ * @param desc The descriptor, the indices of the derived capabilities are written back.
+ * @return ERR_SUCCESS if the channel was established,
+ *         ERR_INVALID_ACCESS if a monitor capability is invalid,
+ *         ERR_INVALID_ARGUMENT if the ends are the same process or the region is larger than the buffer,
+ *         ERR_INVALID_STATE in multikernel builds if an end belongs to another hart,
+ *         or the error of the failing derivation, PMP configuration or transfer.
+ */
+int chan_create(pid_t owner, chan_t *desc);
@@ -2,6 +2,9 @@
 
 #include "types.h"
 
+#define CSR_MIP_MSIP (1 << 3) ///< Machine software interrupt pending.
+#define CSR_MIP_MTIP (1 << 7) ///< Machine timer interrupt pending.
+
 static inline uint64_t csrr_mcycle(void)
 {
 	uint64_t val;
@@ -27,3 +30,21 @@ static inline word_t csrr_mhartid(void)
 	__asm__ volatile("csrr %0, mhartid" : "=r"(val));
 	return val;
 }
+
+static inline void csrw_pmpcfg0(word_t val)
+{
+	__asm__ volatile("csrw pmpcfg0,%0" ::"r"(val));
+}
+
+static inline void csrw_pmpaddr(const word_t addr[8])
+{
+	__asm__ volatile("csrw pmpaddr0,%0\n"
+			 "csrw pmpaddr1,%1\n"
+			 "csrw pmpaddr2,%2\n"
+			 "csrw pmpaddr3,%3\n"
+			 "csrw pmpaddr4,%4\n"
+			 "csrw pmpaddr5,%5\n"
+			 "csrw pmpaddr6,%6\n"
+			 "csrw pmpaddr7,%7" ::"r"(addr[0]),
+			 "r"(addr[1]), "r"(addr[2]), "r"(addr[3]), "r"(addr[4]), "r"(addr[5]), "r"(addr[6]), "r"(addr[7]));
+}
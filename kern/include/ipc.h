@@ -13,13 +13,51 @@ typedef struct {
 	fuel_t csize;
 	ipc_mode_t mode;
 	ipc_flag_t flag;
-	index_t sink;
-	index_t source;
+	uint16_t sink;	 ///< Index of the sink, IPC tables are small enough for 16 bits.
+	uint16_t source; ///< Index of the source.
 	uint32_t opt;
 } __attribute__((aligned(16))) ipc_t;
 
 _Static_assert(sizeof(ipc_t) == 16, "IPC capability has the wrong size.");
 
+/**
+ * Words of a synchronous IPC message. The first two are passed in a2-a3 and received in a1-a2,
+ * the rest in t0-t3 if a7 of the sender, or of the receiver, asks for a long message.
+ */
+#define IPC_MSG_WORDS 6
+
+/**
+ * Capabilities of a synchronous IPC message. The first is passed in a4-a5 and received in a3-a4,
+ * the rest of a long message in t4-t6, packed as capty | index << 8.
+ */
+#define IPC_MSG_CAPS 4
+
+/**
+ * Bytes a bulk copy moves between checks for preemption, bounding the time the kernel
+ * runs without taking the timer interrupt. A multiple of eight words.
+ */
+#define IPC_COPY_CHUNK 512
+
+/**
+ * @struct ipc_msg
+ * @brief A synchronous IPC message.
+ */
+typedef struct ipc_msg {
+	word_t data[IPC_MSG_WORDS];  ///< Message words.
+	capty_t capty[IPC_MSG_CAPS]; ///< Types of the capabilities sent, CAPTY_NONE if unused.
+	index_t cap[IPC_MSG_CAPS];   ///< Indices of the capabilities sent.
+} ipc_msg_t;
+
+/**
+ * @brief Loads the message of a synchronous IPC invocation from the registers of its sender.
+ *
+ * The words and capabilities of a short message after the first ones are zero and CAPTY_NONE.
+ *
+ * @param proc The sender.
+ * @param msg Receives the message.
+ */
+void ipc_msg_get(const proc_t *proc, ipc_msg_t *msg);
+
 void ipc_init();
 
 /**
@@ -42,6 +80,18 @@ void ipc_init(void);
  */
 bool ipc_valid_access(pid_t owner, index_t i);
 
+/**
+ * @brief Retrieves the process an IPC invocation is delivered to.
+ *
+ * For a source capability this is the owner of the sink, for a sink capability
+ * it is the owner of the source capability waiting for a reply.
+ *
+ * @param owner The owner of the capability.
+ * @param i The index of the capability.
+ * @return The PID of the peer, or INVALID_PID if there is none or the access is invalid.
+ */
+pid_t ipc_get_peer(pid_t owner, index_t i);
+
 /**
  * @brief Transfers ownership of an IPC capability.
  *
@@ -83,18 +133,44 @@ int ipc_introspect(pid_t owner, index_t i, fuel_t offset, ipc_t *cap);
  * @param cfree The cfree for the derived capability.
  * @param mode The mode of the derived capability.
  * @param flag The flags for the derived capability.
- * @return The index of the derived capability, or an error code on failure.
+ * @param badge The badge of a derived notification source, ignored for other capabilities.
+ * @return The index of the derived capability, or an error code on failure,
+ *         ERR_INVALID_STATE if an asynchronous sink is derived and all message queues are in use.
  */
-int ipc_derive(pid_t owner, index_t i, pid_t pid, fuel_t cfree, ipc_mode_t mode, ipc_flag_t flag);
+int ipc_derive(pid_t owner, index_t i, pid_t pid, fuel_t cfree, ipc_mode_t mode, ipc_flag_t flag, uint32_t badge);
 
 /**
  * @brief Revokes an IPC capability.
  * @param owner The owner of the capability.
  * @param i The index of the capability.
- * @return The number of revoked capabilities, or an error code on failure.
+ * @return 0 if the children are revoked, the number of unrevoked capabilities if preempted
+ *         while the revocation log was full, or an error code on failure.
  */
 int ipc_revoke(pid_t owner, index_t i);
 
+/**
+ * @brief Reclaims the fuel of deleted children without revoking the live ones.
+ *
+ * Returns the fuel of dead children at the allocation frontier to the capability, stopping
+ * at the first child whose subtable still holds a live capability. Like revoke, only
+ * non-endpoint capabilities can reclaim.
+ *
+ * @param owner The owner of the capability.
+ * @param i The index of the capability.
+ * @return The reclaimed fuel, or an error code on failure.
+ */
+int ipc_reclaim(pid_t owner, index_t i);
+
+/**
+ * @brief Revokes a single child and its subtree, leaving the other children untouched.
+ * @param owner The owner of the capability.
+ * @param i The index of the parent, it must not be an endpoint.
+ * @param j The index of the child, it must be a child of i and not a grandchild.
+ * @return 0 if the child is revoked, the number of unrevoked capabilities if preempted
+ *         while the revocation log was full, or an error code on failure.
+ */
+int ipc_revoke_child(pid_t owner, index_t i, index_t j);
+
 /**
  * @brief Deletes an IPC capability.
  * @param owner The owner of the capability.
@@ -107,69 +183,114 @@ int ipc_delete(pid_t owner, index_t i);
  * @brief Sends data and a capability to another process.
  * @param owner The owner of the IPC capability.
  * @param i The index of the IPC capability.
- * @param data The data to send.
- * @param capty The type of capability to send.
- * @param j The index of the capability to send.
+ * @param msg The message to send, its capabilities are sent all or none.
  * @param next Pointer to store the next process to run.
  * @return ERR_SUCCESS on success, or an error code on failure.
  */
-int ipc_send(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next);
+int ipc_send(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next);
 
 /**
  * @brief Receives data and a capability from another process.
+ *
+ * A receiver on a BSYNC sink can register a destination for ipc_copy while it waits. The
+ * destination is dropped when the receiver gets a message.
+ *
  * @param owner The owner of the IPC capability.
  * @param i The index of the IPC capability.
  * @param next Pointer to store the next process to run.
- * @return ERR_SUCCESS on success, or an error code on failure.
+ * @param servtime The service time of the receiver.
+ * @param mem The index of the receiver's memory capability of the destination.
+ * @param base The start address of the destination.
+ * @param size The size of the destination, 0 to register none.
+ * @return ERR_SUCCESS on success,
+ *         ERR_INVALID_ARGUMENT if the memory capability does not cover the destination with read-write access,
+ *         or an error code on failure.
  */
-int ipc_recv(pid_t owner, index_t i, proc_t **next, uint32_t servtime);
+int ipc_recv(pid_t owner, index_t i, proc_t **next, uint32_t servtime, index_t mem, word_t base, word_t size);
 
 /**
  * @brief Calls a function in another process and waits for a reply.
+ *
+ * If the receiver is busy and the channel has IPC_FLAG_QUEUE, the caller waits in the caller queue
+ * of the sink instead of failing. The receiver takes queued calls in FIFO order on its next ipc_recv,
+ * ipc_replyrecv or ipc_set_wait. On a yielding channel, a queued call fails with ERR_TIMEOUT when it
+ * is taken if the receiver's service time no longer fits before the caller's timeout.
+ *
  * @param owner The owner of the IPC capability.
  * @param i The index of the IPC capability.
- * @param data The data to send.
- * @param capty The type of capability to send.
- * @param j The index of the capability to send.
+ * @param msg The message to send, its capabilities are sent all or none.
  * @param next Pointer to store the next process to run.
  * @return ERR_SUCCESS on success, or an error code on failure.
  */
-int ipc_call(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next);
+int ipc_call(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next);
+
+/**
+ * @brief Copies a range of memory to the destination registered by the receiver, then calls it.
+ *
+ * Copies min(size, destination size) bytes in chunks of IPC_COPY_CHUNK, checking for preemption
+ * between chunks. The progress is kept with the sink, so a preempted copy is resumed by invoking it
+ * again on the same source. The receiver then gets the number of bytes copied and the tag as a call,
+ * and the caller waits for the reply. The destination is bound to the first source that copies to it
+ * until its copy is delivered, or the source is deleted, revoked or transferred. Copies on other
+ * sources of the sink fail meanwhile.
+ *
+ * @param owner The owner of the IPC capability.
+ * @param i The index of a BSYNC source.
+ * @param mem The index of the caller's memory capability of the range.
+ * @param base The start address of the range.
+ * @param size The size of the range.
+ * @param tag Passed to the receiver with the number of bytes copied.
+ * @param done Receives the number of bytes copied so far.
+ * @param next Pointer to store the next process to run.
+ * @return ERR_TIMEOUT if the call waits for the reply,
+ *         ERR_PREEMPTED if the copy was preempted before completion,
+ *         ERR_INVALID_ACCESS if the IPC capability is not a BSYNC source,
+ *         ERR_INVALID_ARGUMENT if the memory capability does not cover the range with read access,
+ *         ERR_INVALID_STATE if the receiver does not wait in ipc_recv with a valid destination,
+ *         or the destination is bound to a copy from another source.
+ */
+int ipc_copy(pid_t owner, index_t i, index_t mem, word_t base, word_t size, word_t tag, word_t *done,
+	     proc_t **next);
 
 /**
  * @brief Replies to a received message and sends a capability.
+ *
+ * Receiving a call gives the receiver a one-shot reply capability in a6, the index of the caller's
+ * source. Replying with it lets a server hold several calls and reply in any order. Replying on a
+ * sink instead targets the most recent call received on it.
+ *
  * @param owner The owner of the IPC capability.
- * @param i The index of the IPC capability.
- * @param data The data to send in the reply.
- * @param capty The type of capability to send.
- * @param j The index of the capability to send.
+ * @param i The index of a sink, or of a reply capability.
+ * @param msg The message to send in the reply, its capabilities are sent all or none.
  * @param next Pointer to store the next process to run.
  * @return ERR_SUCCESS on success, or an error code on failure.
  */
-int ipc_reply(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next);
+int ipc_reply(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next);
 
 /**
  * @brief Replies to a received message and immediately receives another message.
  * @param owner The owner of the IPC capability.
  * @param i The index of the IPC capability.
- * @param data The data to send in the reply.
- * @param capty The type of capability to send.
- * @param j The index of the capability to send.
+ * @param msg The message to send in the reply, its capabilities are sent all or none.
  * @param next Pointer to store the next process to run.
  * @return ERR_SUCCESS on success, or an error code on failure.
  */
-int ipc_replyrecv(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next, uint32_t servtime);
+int ipc_replyrecv(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next, uint32_t servtime);
 
 /**
  * @brief Asynchronously sends data to another process.
  *
- * This function allows non-blocking communication between processes.
+ * This function allows non-blocking communication between processes. The data is
+ * appended to the message queue of the sink, which holds up to MAX_IPC_QUEUE words.
+ * A notification source ORs its badge, or the data if its badge is zero, into the
+ * signal word of the sink instead. The signal, truncated to 32 bits, must not be zero.
  *
  * @param owner The owner of the IPC capability.
  * @param i The index of the IPC capability.
  * @param data The data to send.
  * @param next Pointer to store the next process to run.
- * @return ERR_SUCCESS on success, or an error code on failure.
+ * @return ERR_SUCCESS on success, ERR_INVALID_STATE if the queue is full,
+ *         ERR_INVALID_ARGUMENT if a notification source sends an empty signal, or an error code on failure.
  */
 int ipc_asend(pid_t owner, index_t i, word_t data, proc_t **next);
 
@@ -177,7 +298,103 @@ int ipc_asend(pid_t owner, index_t i, word_t data, proc_t **next);
  * @brief Asynchronously receives data from another process.
  * @param owner The owner of the IPC capability.
  * @param i The index of the IPC capability.
- * @param data Pointer to store the received data.
- * @return ERR_SUCCESS on success, or an error code on failure.
+ * @param data Pointer to store the oldest queued message, or the pending signals of a notification sink,
+ *             which are cleared.
+ * @return ERR_SUCCESS on success, ERR_INVALID_STATE if nothing is pending, or an error code on failure.
  */
 int ipc_arecv(pid_t owner, index_t i, word_t *data);
+
+/**
+ * @brief Asynchronously receives data, blocking until data arrives if nothing is pending.
+ *
+ * The process is blocked on the sink until ipc_asend completes the receive, or until the
+ * timeout, when the scheduler wakes it with ERR_TIMEOUT.
+ *
+ * @param owner The owner of the IPC capability.
+ * @param i The index of the IPC capability.
+ * @param data Pointer to store the data if it was pending.
+ * @param timeout The time to wait until, 0 waits without a timeout.
+ * @param next Pointer to store the next process to run, NULL if the process is blocked.
+ * @return ERR_SUCCESS if data was pending, ERR_TIMEOUT if the process blocked or the timeout
+ *         has passed, or an error code on failure.
+ */
+int ipc_arecv_wait(pid_t owner, index_t i, word_t *data, uint64_t timeout, proc_t **next);
+
+/**
+ * @brief Wakes a process whose ipc_arecv_wait or ipc_set_wait has timed out.
+ *
+ * Called by the scheduler for a process that is past its timeout but not ready.
+ *
+ * @param pid The process ID of the process.
+ * @return `true` if the process was waiting on a sink and is now acquired, `false` otherwise.
+ */
+bool ipc_wait_expire(pid_t pid);
+
+/**
+ * @brief Adds a sink to the endpoint set of another sink.
+ *
+ * A process waiting on an endpoint set with ipc_set_wait is woken by the first sender on any member.
+ *
+ * @param owner The owner of both sinks.
+ * @param i The index of a sink in the set.
+ * @param j The index of the sink joining the set.
+ * @return ERR_SUCCESS on success, ERR_INVALID_STATE if sink j is already in a set,
+ *         or ERR_INVALID_ACCESS if either capability is not a sink of the owner.
+ */
+int ipc_set_join(pid_t owner, index_t i, index_t j);
+
+/**
+ * @brief Removes a sink from its endpoint set.
+ *
+ * Deleting, revoking or transferring a sink also removes it from its set.
+ *
+ * @param owner The owner of the sink.
+ * @param i The index of the sink.
+ * @return ERR_SUCCESS on success, or ERR_INVALID_ACCESS if the capability is not a sink of the owner.
+ */
+int ipc_set_leave(pid_t owner, index_t i);
+
+/**
+ * @brief Receives from any member of an endpoint set, blocking until the first sender if nothing is pending.
+ *
+ * Pending asynchronous messages and signals are received first, then calls waiting in the caller
+ * queues of the members. Otherwise the process blocks on sink i, and the first ipc_send, ipc_call or
+ * ipc_asend to a member completes the receive. The message is written to the owner's registers
+ * a1-a4 as for ipc_recv, with the index of the member in a5.
+ *
+ * @param owner The owner of the sink.
+ * @param i The index of a sink in the set.
+ * @param servtime The service time of the synchronous members, as for ipc_recv.
+ * @param timeout The time to wait until, 0 waits without a timeout.
+ * @param next Pointer to store the next process to run, NULL if the process is blocked.
+ * @return ERR_SUCCESS if a message was pending, ERR_TIMEOUT if the process blocked or the timeout
+ *         has passed, or an error code on failure.
+ */
+int ipc_set_wait(pid_t owner, index_t i, uint32_t servtime, uint64_t timeout, proc_t **next);
+
+/**
+ * @brief Asynchronously receives up to count messages in the order they were sent.
+ * @param owner The owner of the IPC capability.
+ * @param i The index of the IPC capability.
+ * @param buf Receives the messages.
+ * @param count The maximum number of messages to receive.
+ * @return The number of messages received, or an error code on failure.
+ */
+int ipc_adrain(pid_t owner, index_t i, word_t *buf, word_t count);
+
+/**
+ * Lists the IPC capabilities of a process.
+ *
+ * @param owner The process ID of the owner.
+ * @param buf Receives the indices of the capabilities, starting with the offset-th.
+ * @param count The maximum number of indices to write to buf.
+ * @param offset The number of capabilities to skip.
+ * @return The number of IPC capabilities owned by the process.
+ */
+word_t ipc_list(pid_t owner, index_t *buf, word_t count, word_t offset);
+
+/**
+ * Sweeps a bounded number of revoked IPC capabilities.
+ * Called on every system call, revoked capabilities are already unusable before they are swept.
+ */
+void ipc_sweep(void);
@@ -2,6 +2,15 @@
 
 #include "types.h"
 
+/**
+ * Lock statistics of a hart.
+ */
+typedef struct lock_stat {
+	uint64_t acquired;  ///< Number of times the lock was acquired.
+	uint64_t contended; ///< Number of acquisitions that found the lock taken.
+	uint64_t wait;	    ///< Cycles spent waiting for the lock.
+} lock_stat_t;
+
 /**
  * Initializes the lock.
  */
@@ -16,3 +25,14 @@ bool lock_acquire(bool preemptable);
  * Releases the lock.
  */
 void lock_release(void);
+
+/**
+ * Retrieves the lock statistics of a hart.
+ *
+ * @param hart The hart to get the statistics of.
+ * @param stat A pointer to store the statistics.
+ * @return ERR_SUCCESS if the statistics are retrieved,
+ *         ERR_INVALID_ARGUMENT if the hart does not exist,
+ *         ERR_INVALID_STATE if lock statistics are disabled.
+ */
+int lock_stat_get(word_t hart, lock_stat_t *stat);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "types.h"
+
+/**
+ * Number of cells in a mailbox, the smallest power of two holding two requests per process.
+ */
+#define MAILBOX_SIZE (1u << (32 - __builtin_clz(2u * MAX_PID - 1)))
+#define MAILBOX_MASK (MAILBOX_SIZE - 1)
+
+/**
+ * Bounded lock-free multi-producer single-consumer queue of PIDs.
+ *
+ * Each cell has a sequence number telling whether it is free or full for the
+ * current lap of the ring. A zero-initialized mailbox is empty.
+ */
+typedef struct mailbox {
+	uint32_t head; ///< Next position to pop, only accessed by the consumer.
+	uint32_t tail; ///< Next position to push.
+
+	struct {
+		uint32_t seq; ///< Lap of the cell, plus one if the cell is full.
+		pid_t pid;    ///< The queued PID.
+	} cells[MAILBOX_SIZE];
+} mailbox_t;
+
+/**
+ * Pushes a PID to the mailbox, may be called by any hart.
+ *
+ * @return true if the PID was pushed, false if the mailbox is full.
+ */
+bool mailbox_push(mailbox_t *mb, pid_t pid);
+
+/**
+ * Reads the PID at the head of the mailbox, must only be called by the owning hart.
+ *
+ * @return true if a PID was read, false if the mailbox is empty.
+ */
+bool mailbox_peek(mailbox_t *mb, pid_t *pid);
+
+/**
+ * Removes the PID at the head of the mailbox, must only be called by the owning hart
+ * after a successful mailbox_peek.
+ */
+void mailbox_pop(mailbox_t *mb);
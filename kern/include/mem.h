@@ -31,6 +31,18 @@ void mem_init(mem_t init_mems[]);
  */
 bool mem_valid_access(pid_t owner, index_t i);
 
+/**
+ * Checks if a memory capability of the owner covers a range with the given permissions.
+ *
+ * @param owner The owner of the capability.
+ * @param i The index of the capability.
+ * @param base The start address of the range.
+ * @param size The size of the range.
+ * @param rwx The permissions required.
+ * @return true if the capability is valid and covers [base, base + size) with rwx, false otherwise.
+ */
+bool mem_valid_range(pid_t owner, index_t i, word_t base, word_t size, mem_perm_t rwx);
+
 /**
  * Transfer a memory capability from one process to another.
  *
@@ -88,11 +100,43 @@ int mem_derive(pid_t owner, index_t i, pid_t child_pid, fuel_t child_fuel, mem_p
  *
  * @param owner The process ID associated with the memory capability.
  * @param index The index in the memory table.
+ * The children are revoked in constant time, their PMP slots are cleared before it returns.
+ *
  * @return ERR_SUCCESS if the memory capability is successfully revoked,
- *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table.
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table,
+ *         the number of unrevoked capabilities if preempted while the revocation log was full.
  */
 int mem_revoke(pid_t owner, index_t i);
 
+/**
+ * Reclaims the fuel of deleted children without revoking the live ones.
+ *
+ * Returns the fuel of dead children at the allocation frontier to the capability, stopping at the
+ * first child whose subtable still holds a live capability.
+ *
+ * @param owner The process ID associated with the memory capability.
+ * @param index The index in the memory table.
+ * @return The reclaimed fuel,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table.
+ */
+int mem_reclaim(pid_t owner, index_t i);
+
+/**
+ * Revokes a single child and its subtree, leaving the other children untouched.
+ *
+ * The subtree is revoked in constant time, its PMP slots are cleared before it returns.
+ * The siblings keep their PMP slots.
+ *
+ * @param owner The process ID associated with the memory capability.
+ * @param i The index of the parent in the memory table.
+ * @param j The index of the child, it must be a child of i and not a grandchild.
+ * @return ERR_SUCCESS if the child is revoked, its fuel is merged back if it was at the allocation frontier,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table,
+ *         ERR_INVALID_ARGUMENT if j is not a child of i,
+ *         the number of unrevoked capabilities if preempted while the revocation log was full.
+ */
+int mem_revoke_child(pid_t owner, index_t i, index_t j);
+
 /**
  * Deletes a memory capability by invalidating its process ID.
  *
@@ -106,17 +150,21 @@ int mem_delete(pid_t owner, index_t i);
 /**
  * Enables a memory capability by setting a PMP slot.
  *
+ * Bits 3-4 of rwx select the PMP mode, zero selects NAPOT. A TOR region covers
+ * [addr << 2, top << 2) and also occupies slot - 1, which holds its bottom address.
+ *
  * @param owner The process ID of the owner of the memory capability.
  * @param index The index in the memory table of the capability to be enabled.
  * @param slot The PMP slot to be set.
- * @param rwx The permissions for the PMP slot.
- * @param addr The address for the PMP slot.
+ * @param rwx The mode and permissions for the PMP slot.
+ * @param addr The address for the PMP slot, the bottom address for TOR.
+ * @param top The top address for TOR, ignored otherwise.
  * @return ERR_SUCCESS if the capability is successfully enabled,
  *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table,
  *         ERR_INVALID_ARGUMENT if the PMP arguments are invalid,
  *         ERR_SLOT_IN_USE if the PMP slot is already in use.
  */
-int mem_pmp_set(pid_t owner, index_t i, pmp_slot_t slot, word_t rwx, word_t addr);
+int mem_pmp_set(pid_t owner, index_t i, pmp_slot_t slot, word_t rwx, word_t addr, word_t top);
 
 /**
  * Retrieves the PMP configuration for a memory capability.
@@ -124,12 +172,13 @@ int mem_pmp_set(pid_t owner, index_t i, pmp_slot_t slot, word_t rwx, word_t addr
  * @param owner The process ID of the owner of the memory capability.
  * @param index The index in the memory table of the capability.
  * @param slot A pointer to store the PMP slot.
- * @param rwx A pointer to store the permissions for the PMP slot.
- * @param addr A pointer to store the address for the PMP slot.
+ * @param rwx A pointer to store the mode and permissions for the PMP slot, as passed to mem_pmp_set.
+ * @param addr A pointer to store the address for the PMP slot, the bottom address for TOR.
+ * @param top A pointer to store the top address for TOR, zero otherwise.
  * @return ERR_SUCCESS if the PMP configuration is successfully retrieved,
  *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table.
  */
-int mem_pmp_get(pid_t owner, index_t i, pmp_slot_t *slot, mem_perm_t *rwx, pmp_addr_t *addr);
+int mem_pmp_get(pid_t owner, index_t i, pmp_slot_t *slot, word_t *rwx, pmp_addr_t *addr, pmp_addr_t *top);
 
 /**
  * Disables a memory capability by clearing its PMP slot.
@@ -140,3 +189,50 @@ int mem_pmp_get(pid_t owner, index_t i, pmp_slot_t *slot, mem_perm_t *rwx, pmp_a
  *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table.
  */
 int mem_pmp_clear(pid_t owner, index_t i);
+
+/**
+ * Marks a memory capability as mapped on demand, clearing its PMP slot.
+ *
+ * The capability is installed in a PMP slot when the process faults on its region,
+ * replacing other capabilities mapped on demand if no slot is free. Setting a PMP
+ * slot with mem_pmp_set pins the capability again.
+ *
+ * @param owner The process ID of the owner of the memory capability.
+ * @param index The index in the memory table of the capability.
+ * @return ERR_SUCCESS if the capability is marked,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the memory table,
+ *         ERR_INVALID_ARGUMENT if the capability has no permissions or its region can not be encoded in PMP slots.
+ */
+int mem_pmp_demand(pid_t owner, index_t i);
+
+/**
+ * Handles a PMP access fault by installing a capability mapped on demand.
+ *
+ * Finds a capability of the process, mapped on demand, covering the address with the
+ * required permissions and installs its whole region, evicting other capabilities mapped
+ * on demand with the clock algorithm if needed. The process's PMP registers must be
+ * reloaded afterwards.
+ *
+ * @param pid The process ID of the faulting process.
+ * @param addr The faulting address.
+ * @param rwx The permission required by the access.
+ * @return true if the access can be retried, false if the fault should be delegated.
+ */
+bool mem_fault(pid_t pid, word_t addr, mem_perm_t rwx);
+
+/**
+ * Lists the memory capabilities of a process.
+ *
+ * @param owner The process ID of the owner.
+ * @param buf Receives the indices of the capabilities, starting with the offset-th.
+ * @param count The maximum number of indices to write to buf.
+ * @param offset The number of capabilities to skip.
+ * @return The number of memory capabilities owned by the process.
+ */
+word_t mem_list(pid_t owner, index_t *buf, word_t count, word_t offset);
+
+/**
+ * Sweeps a bounded number of revoked memory capabilities.
+ * Called on every system call, revoked capabilities are already unusable before they are swept.
+ */
+void mem_sweep(void);
@@ -67,25 +67,58 @@ int mon_introspect(pid_t owner, index_t i, fuel_t offset, mon_t *cap);
  * @param child_fuel The amount of cfree for the new capability.
  * @return The index of the new monitor capability if successfully derived,
  *         ERR_INVALID_ACCESS if the owner does not match the entry in the monitor table,
- *         ERR_INVALID_ARGUMENT if the new monitor capability cannot be derived.
+ *         ERR_INVALID_ARGUMENT if the new monitor capability cannot be derived,
+ *         ERR_INVALID_STATE if the root has no block for its descendants and the pool is empty.
  */
 int mon_derive(pid_t owner, index_t i, pid_t child_pid, fuel_t child_fuel);
 
 /**
  * Revokes a monitor capability and its derived capabilities.
  *
- * @note This function invalidates the capability and all its children.
+ * @note This function invalidates all children of the capability in constant time.
  *
  * @param owner The process ID associated with the monitor capability.
  * @param index The index in the monitor table of the capability to be revoked.
  * @return ERR_SUCCESS if the capability is successfully revoked,
- *         ERR_INVALID_ACCESS if the owner does not match the entry in the monitor table.
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the monitor table,
+ *         the number of unrevoked capabilities if preempted while the revocation log was full.
  */
 int mon_revoke(pid_t owner, index_t i);
 
+/**
+ * Reclaims the fuel of deleted children without revoking the live ones.
+ *
+ * Returns the fuel of dead children at the allocation frontier to the capability, stopping at the
+ * first child whose subtable still holds a live capability. A root left without descendants
+ * releases its block.
+ *
+ * @param owner The process ID associated with the monitor capability.
+ * @param index The index in the monitor table.
+ * @return The reclaimed fuel,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the monitor table.
+ */
+int mon_reclaim(pid_t owner, index_t i);
+
+/**
+ * Revokes a single child and its subtree, leaving the other children untouched.
+ *
+ * The subtree is revoked in constant time.
+ *
+ * @param owner The process ID associated with the monitor capability.
+ * @param i The index of the parent in the monitor table.
+ * @param j The index of the child, it must be a child of i and not a grandchild.
+ * @return ERR_SUCCESS if the child is revoked, its fuel is merged back if it was at the allocation frontier,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the monitor table,
+ *         ERR_INVALID_ARGUMENT if j is not a child of i,
+ *         the number of unrevoked capabilities if preempted while the revocation log was full.
+ */
+int mon_revoke_child(pid_t owner, index_t i, index_t j);
+
 /**
  * Deletes a monitor capability.
  *
+ * Deleting the last live descendant of a root releases the root's block.
+ *
  * @param owner The process ID associated with the monitor capability.
  * @param index The index in the monitor table of the capability to be deleted.
  * @return ERR_SUCCESS if the capability is successfully deleted,
@@ -146,3 +179,20 @@ int mon_vreg_get(pid_t owner, index_t i, vreg_t reg, word_t *value);
  * Set the virtual register value for the monitored process.
  */
 int mon_vreg_set(pid_t owner, index_t i, vreg_t reg, word_t value);
+
+/**
+ * Lists the monitor capabilities of a process.
+ *
+ * @param owner The process ID of the owner.
+ * @param buf Receives the indices of the capabilities, starting with the offset-th.
+ * @param count The maximum number of indices to write to buf.
+ * @param offset The number of capabilities to skip.
+ * @return The number of monitor capabilities owned by the process.
+ */
+word_t mon_list(pid_t owner, index_t *buf, word_t count, word_t offset);
+
+/**
+ * Sweeps a bounded number of revoked monitor capabilities.
+ * Called on every system call, revoked capabilities are already unusable before they are swept.
+ */
+void mon_sweep(void);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ttas.h"
+#include "types.h"
+
+/**
+ * Links of a capability in the list of its owner.
+ * Indices are stored plus one, so zero-initialized links are unlisted.
+ */
+typedef struct owner_link {
+	index_t next; ///< Next index plus one, 0 if last.
+	index_t prev; ///< Previous index plus one, 0 if first.
+	pid_t owner;  ///< Owner of the list holding the capability, INVALID_PID if unlisted.
+} owner_link_t;
+
+/**
+ * Ownership index of a capability table, an intrusive list of the capabilities of each process.
+ *
+ * Deleting or transferring a capability moves it eagerly. Revoked capabilities are
+ * left in the list when they are swept, and are removed when the list is enumerated
+ * or when their index is reused.
+ */
+typedef struct owner_index {
+	index_t head[MAX_PID]; ///< First index plus one of each process's list.
+#ifdef MULTIKERNEL
+	ttas_t lock; ///< Harts share the capability tables.
+#endif
+} owner_index_t;
+
+/**
+ * Returns the links of the capability at index i.
+ */
+typedef owner_link_t *(*owner_link_fn_t)(index_t i);
+
+/**
+ * Checks if the capability at index i is valid and owned by owner.
+ * Called with the index locked, it may lock the table's revocation log.
+ */
+typedef bool (*owner_valid_t)(pid_t owner, index_t i);
+
+/**
+ * Checks if the capability at index i is the one searched for.
+ */
+typedef bool (*owner_match_t)(index_t i, void *ctx);
+
+/**
+ * Moves a capability to the list of a new owner.
+ *
+ * @param idx The ownership index of the table.
+ * @param i The index of the capability.
+ * @param owner The new owner, INVALID_PID removes the capability from its list.
+ * @param link Returns the links of a capability.
+ */
+void owner_set(owner_index_t *idx, index_t i, pid_t owner, owner_link_fn_t link);
+
+/**
+ * Enumerates the valid capabilities of a process, removing invalid ones from its list.
+ *
+ * @param idx The ownership index of the table.
+ * @param owner The process ID of the owner.
+ * @param link Returns the links of a capability.
+ * @param valid Checks if a listed capability is still valid.
+ * @param buf Receives the indices, starting with the offset-th capability.
+ * @param count The maximum number of indices to write to buf.
+ * @param offset The number of capabilities to skip.
+ * @return The number of valid capabilities of the process.
+ */
+word_t owner_list(owner_index_t *idx, pid_t owner, owner_link_fn_t link, owner_valid_t valid, index_t *buf,
+		  word_t count, word_t offset);
+
+/**
+ * Finds a valid capability of a process, removing invalid ones from its list.
+ *
+ * @param idx The ownership index of the table.
+ * @param owner The process ID of the owner.
+ * @param link Returns the links of a capability.
+ * @param valid Checks if a listed capability is still valid.
+ * @param match Checks if a valid capability is the one searched for.
+ * @param ctx Passed to match.
+ * @param i Receives the index of the first matching capability.
+ * @return true if a capability matched, false otherwise.
+ */
+bool owner_find(owner_index_t *idx, pid_t owner, owner_link_fn_t link, owner_valid_t valid, owner_match_t match,
+		void *ctx, index_t *i);
@@ -35,3 +35,32 @@ static inline word_t pmp_napot_encode(word_t base, word_t size)
 {
 	return (base | (size / 2 - 1)) >> 2; // Combine base and size into NAPOT format.
 }
+
+/**
+ * @brief Decode the region of a PMP entry.
+ *
+ * A TOR entry covers the range from the address of the entry below it.
+ *
+ * @param cfg The configuration of the entry.
+ * @param bottom The address of the entry below, used by TOR entries.
+ * @param addr The address of the entry.
+ * @param base Receives the base address of the region.
+ * @return The size of the region, zero if the entry is off or empty.
+ */
+static inline word_t pmp_decode(pmp_cfg_t cfg, pmp_addr_t bottom, pmp_addr_t addr, word_t *base)
+{
+	switch (cfg & PMP_MODE_NAPOT) {
+	case PMP_MODE_TOR:
+		*base = bottom << 2;
+		return (addr > bottom) ? (addr - bottom) << 2 : 0;
+	case PMP_MODE_NA4:
+		*base = addr << 2;
+		return 4;
+	case PMP_MODE_NAPOT:
+		*base = pmp_napot_decode_base(addr);
+		return pmp_napot_decode_size(addr);
+	default:
+		*base = 0;
+		return 0;
+	}
+}
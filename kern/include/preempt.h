@@ -2,8 +2,6 @@
 
 #include "csr.h"
 
-#define CSR_MIP_MTIP (1 << 7)
-
 /**
  * Check if the current hart should preempt.
  */
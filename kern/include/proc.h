@@ -10,7 +10,7 @@
  * registers, PMP configuration, and process ID.
  */
 typedef struct proc {
-	word_t state; ///< Process state.
+	word_t state; ///< Process state, only updated with atomic operations (see proc_state).
 
 	struct {
 		word_t pc, ra, sp, gp, tp;				 ///< Special registers.
@@ -30,6 +30,11 @@ typedef struct proc {
 		word_t epc, esp;
 	} trap;
 
+	struct {
+		word_t faults;	  ///< Access faults handled by installing a capability mapped on demand.
+		word_t evictions; ///< Capabilities mapped on demand evicted from a PMP slot.
+	} pmp_stat;
+
 	uint64_t timeout; ///< Timeout for the process, used for scheduling.
 	word_t pid;	  ///< Process ID.
 } __attribute__((aligned(sizeof(word_t)))) proc_t;
@@ -41,6 +46,8 @@ typedef enum {
 	VREG_EVAL = 3,
 	VREG_EPC = 4,
 	VREG_ESP = 5,
+	VREG_PMP_FAULTS = 6,
+	VREG_PMP_EVICTIONS = 7,
 } vreg_t;
 
 /**
@@ -49,14 +56,29 @@ typedef enum {
  *
  * This enumeration defines flags for the different states a process can be in.
  * The states include ready, running, blocked, and suspended.
+ *
+ * A blocked process also stores the index of the IPC capability it waits on,
+ * shifted by PROC_STATE_INDEX_SHIFT. All transitions are single CAS or AMO
+ * operations on the state word, so they do not depend on the kernel lock.
+ * Acquiring a process has acquire ordering and releasing it has release
+ * ordering, so the hart that acquires a process observes the context saved
+ * by the hart that released it.
+ *
+ * In multikernel builds, a process whose system call is forwarded to another
+ * hart is marked forwarded until the call has been serviced.
  */
 typedef enum proc_state {
 	PROC_STATE_READY = 0,	  ///< Process is ready to run.
-	PROC_STATE_ACQUIRED = 1,  /////< Process is acquired and running.
+	PROC_STATE_ACQUIRED = 1,  ///< Process is acquired and running.
 	PROC_STATE_BLOCKED = 2,	  ///< Process is blocked and waiting for an event.
 	PROC_STATE_SUSPENDED = 4, ///< Process is suspended and not eligible to run.
+	PROC_STATE_FORWARDED = 8, ///< Process waits for a system call serviced by another hart.
 } proc_state_t;
 
+#define PROC_STATE_INDEX_SHIFT 4 ///< Shift of the IPC index in the state of a blocked process.
+
+_Static_assert(IPC_TABLE_SIZE - 1 <= (~(word_t)0 >> PROC_STATE_INDEX_SHIFT), "IPC index does not fit in the state.");
+
 /**
  * @brief Check if a PID is valid.
  */
@@ -65,6 +87,19 @@ static inline bool proc_valid_pid(pid_t pid)
 	return pid != INVALID_PID && pid <= MAX_PID;
 }
 
+#ifdef MULTIKERNEL
+/**
+ * @brief The hart owning a process.
+ *
+ * In multikernel builds, the process table is sliced between the harts and
+ * a process only runs on its own hart.
+ */
+static inline hart_t proc_hart(pid_t pid)
+{
+	return (pid - 1) % NUM_HARTS;
+}
+#endif
+
 /**
  * @brief Initialize the process table.
  *
@@ -102,19 +137,21 @@ pid_t proc_get_pid(const proc_t *p);
  * @brief Set a PMP slot for a process.
  *
  * This function configures a PMP slot for the specified process with the given
- * permissions and address.
+ * mode, permissions and address. A TOR region uses the address of the slot below
+ * as its bottom, that slot is configured with PMP_MODE_OFF.
  *
  * @param pid The process ID of the process to configure.
  * @param slot The PMP slot to configure.
- * @param rwx The permissions to set (read, write, execute).
+ * @param cfg The mode and permissions to set (read, write, execute).
  * @param addr The address to associate with the PMP slot.
  */
-void proc_pmp_set(pid_t pid, pmp_slot_t slot, mem_perm_t rwx, pmp_addr_t addr);
+void proc_pmp_set(pid_t pid, pmp_slot_t slot, pmp_cfg_t cfg, pmp_addr_t addr);
 
 /**
  * @brief Clear a PMP slot for a process.
  *
  * This function clears the configuration of a PMP slot for the specified process.
+ * Clearing a TOR slot also clears the slot below holding its bottom address.
  *
  * @param pid The process ID of the process to configure.
  * @param slot The PMP slot to clear.
@@ -124,7 +161,8 @@ void proc_pmp_clear(pid_t pid, pmp_slot_t slot);
 /**
  * @brief Check if a PMP slot is set for a process.
  *
- * This function checks whether a PMP slot is configured for the specified process.
+ * This function checks whether a PMP slot is configured for the specified process,
+ * or holds the bottom address of a TOR slot.
  *
  * @param pid The process ID of the process to check.
  * @param slot The PMP slot to check.
@@ -139,10 +177,34 @@ bool proc_pmp_is_set(pid_t pid, pmp_slot_t slot);
  *
  * @param pid The process ID of the process to retrieve.
  * @param slot The PMP slot to retrieve.
- * @param rwx A pointer to store the permissions for the PMP slot.
+ * @param cfg A pointer to store the mode and permissions for the PMP slot.
  * @param addr A pointer to store the address for the PMP slot.
  */
-void proc_pmp_get(pid_t pid, pmp_slot_t slot, mem_perm_t *rwx, pmp_addr_t *addr);
+void proc_pmp_get(pid_t pid, pmp_slot_t slot, pmp_cfg_t *cfg, pmp_addr_t *addr);
+
+/**
+ * @brief Check if a process's PMP configuration grants access to a memory range.
+ *
+ * Like the hardware, the lowest slot overlapping the range decides, so that slot
+ * must cover the whole range with the requested permissions.
+ *
+ * @param pid The process ID of the process to check.
+ * @param addr The start of the range.
+ * @param size The size of the range in bytes.
+ * @param rwx The permissions required for the range.
+ * @return `true` if the process may access the whole range, `false` otherwise.
+ */
+bool proc_pmp_check(pid_t pid, word_t addr, word_t size, mem_perm_t rwx);
+
+/**
+ * @brief Load the PMP configuration of a process into the PMP registers.
+ *
+ * Switching process loads the registers, this is for changes to the running process
+ * that return to it directly.
+ *
+ * @param pid The process ID of the running process.
+ */
+void proc_pmp_load(pid_t pid);
 
 /**
  * @brief Acquire a process.
@@ -174,6 +236,116 @@ void proc_suspend(pid_t pid);
  */
 void proc_resume(pid_t pid);
 
+/**
+ * @brief Check if a process is suspended, and neither running nor waiting.
+ *
+ * @param pid The process ID of the process to check.
+ * @return `true` if the process is only suspended, `false` otherwise.
+ */
+bool proc_is_suspended(pid_t pid);
+
+/**
+ * @brief Acquire a process blocked on an IPC capability.
+ *
+ * Atomically moves the process from blocked on index `i` to acquired.
+ *
+ * @param pid The process ID of the process to acquire.
+ * @param i The index of the IPC capability the process must be blocked on.
+ * @return `true` if the process was acquired, `false` otherwise.
+ */
 bool proc_ipc_acquire(pid_t pid, index_t i);
+
+/**
+ * @brief Block an acquired process on an IPC capability.
+ *
+ * The process remains acquired until it is released, so no other hart can
+ * acquire it before its context has been saved.
+ *
+ * @param pid The process ID of the process to block.
+ * @param i The index of the IPC capability to block on.
+ * @return `true` if the process was blocked, `false` if it was not acquired.
+ */
 bool proc_ipc_block(pid_t pid, index_t i);
+
+/**
+ * @brief Check which IPC capability a process is blocked on.
+ *
+ * @param pid The process ID of the process.
+ * @param i Receives the index of the IPC capability.
+ * @return `true` if the process is blocked on IPC and in no other state, `false` otherwise.
+ */
+bool proc_ipc_waiting(pid_t pid, index_t *i);
+
+/**
+ * @brief Release an acquired process.
+ *
+ * Clears the acquired flag with release ordering.
+ *
+ * @param pid The process ID of the process to release.
+ */
 void proc_release(pid_t pid);
+
+#ifdef MULTIKERNEL
+/**
+ * @brief Mark an acquired process as forwarded.
+ *
+ * The process is released as usual when its hart switches to another process,
+ * after which the hart servicing the call can acquire it with proc_forward_acquire.
+ *
+ * @param pid The process ID of the process that forwards its system call.
+ */
+void proc_forward(pid_t pid);
+
+/**
+ * @brief Cancel a forwarded system call, the process restarts the call when it runs again.
+ *
+ * @param pid The process ID of the forwarded process.
+ */
+void proc_forward_cancel(pid_t pid);
+
+/**
+ * @brief Acquire a forwarded process to service its system call.
+ *
+ * The process stays marked as forwarded while it is serviced.
+ *
+ * @param pid The process ID of the forwarded process.
+ * @return `true` if the process was acquired, `false` if it has not been released by
+ *         its hart yet, or the call was cancelled by suspending the process.
+ * @note A call of a suspended process is cancelled, the process restarts it when resumed.
+ */
+bool proc_forward_acquire(pid_t pid);
+
+/**
+ * @brief Release a process after servicing its forwarded system call.
+ *
+ * @param pid The process ID of the forwarded process.
+ */
+void proc_forward_release(pid_t pid);
+
+/**
+ * @brief Check if a process has a forwarded system call pending or in service.
+ *
+ * @param pid The process ID of the process to check.
+ * @return `true` if the process is forwarded, `false` otherwise.
+ */
+bool proc_is_forwarded(pid_t pid);
+
+/**
+ * @brief Acknowledge the PMP shootdowns requested from this hart.
+ *
+ * Must be called in the kernel before the PMP registers are loaded for the process that
+ * runs next, which is every switch to a process and proc_pmp_load.
+ */
+void proc_pmp_sync(void);
+
+/**
+ * @brief Shoot down PMP entries cleared from processes running on other harts.
+ *
+ * Interrupts each hart in the set and waits until it has acknowledged, after which it
+ * no longer has the cleared entries loaded. Shootdowns requested from this hart are
+ * acknowledged while waiting, so two harts shooting down each other do not deadlock.
+ *
+ * @param harts Bitmap of the harts, this hart must not be included.
+ */
+void proc_pmp_shootdown(word_t harts);
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ttas.h"
+#include "types.h"
+
+#define REVOKE_MAX_RANGES 8    ///< Pending revocations per capability table.
+#define REVOKE_SWEEP_BUDGET 8 ///< Capabilities swept per table on each system call.
+
+/**
+ * Range of a capability table invalidated by a revocation.
+ */
+typedef struct revoke_range {
+	index_t begin; ///< First revoked index.
+	index_t end;   ///< One past the last revoked index.
+} revoke_range_t;
+
+/**
+ * Log of pending revocations of a capability table.
+ *
+ * The descendants of a capability occupy the indices below its last index,
+ * so revoking a capability only records the range of its children in the
+ * log and returns the fuel to the parent. A capability in a pending range is
+ * stale, its entry is invalidated when the range is swept in the background,
+ * or when the parent derives a new child at its index.
+ */
+typedef struct revoke_log {
+	uint8_t count;				   ///< Number of pending ranges.
+	revoke_range_t ranges[REVOKE_MAX_RANGES]; ///< Pending ranges, oldest first.
+#ifdef MULTIKERNEL
+	ttas_t lock; ///< Harts share the capability tables.
+#endif
+} revoke_log_t;
+
+/**
+ * Invalidates the entry of a stale capability.
+ * Called with the log locked, so it must not access the log.
+ */
+typedef void (*revoke_sweep_t)(index_t i);
+
+/**
+ * Checks if a capability is in a pending range.
+ *
+ * @param log The log of the capability's table.
+ * @param i The index of the capability.
+ * @return true if the capability is stale, false otherwise.
+ */
+bool revoke_stale(revoke_log_t *log, index_t i);
+
+/**
+ * Records a revoked range.
+ *
+ * If the log is full, the oldest range is swept first.
+ *
+ * @param log The log of the table.
+ * @param begin The first revoked index.
+ * @param end One past the last revoked index.
+ * @param sweep Invalidates stale entries of the table.
+ * @return true if the range was recorded, false if preempted while sweeping.
+ */
+bool revoke_push(revoke_log_t *log, index_t begin, index_t end, revoke_sweep_t sweep);
+
+/**
+ * Sweeps a stale entry before a new capability is derived at its index.
+ *
+ * Only index i leaves the log, the rest of the new capability's range stays
+ * stale until it is derived into or swept in the background. Removing i from
+ * the middle of a range splits it. If the log is full, up to
+ * REVOKE_SWEEP_BUDGET entries of the oldest range are swept to make room, and
+ * if it is still full the smaller part of the range is swept instead, which is
+ * the worst case.
+ *
+ * @param log The log of the table.
+ * @param i The index of the new capability.
+ * @param sweep Invalidates stale entries of the table.
+ */
+void revoke_claim(revoke_log_t *log, index_t i, revoke_sweep_t sweep);
+
+/**
+ * Sweeps up to REVOKE_SWEEP_BUDGET stale entries, starting with the oldest range.
+ *
+ * @param log The log of the table.
+ * @param sweep Invalidates stale entries of the table.
+ */
+void revoke_sweep(revoke_log_t *log, revoke_sweep_t sweep);
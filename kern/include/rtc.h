@@ -33,3 +33,17 @@ uint64_t rtc_get_timeout(word_t hartid);
  * @param time Timeout value to set, as a 64-bit unsigned integer.
  */
 void rtc_set_timeout(word_t hartid, uint64_t time);
+
+/**
+ * @brief Raise the software interrupt of a specific hardware thread (hart).
+ *
+ * @param hartid ID of the hardware thread.
+ */
+void rtc_send_ipi(word_t hartid);
+
+/**
+ * @brief Clear the software interrupt of a specific hardware thread (hart).
+ *
+ * @param hartid ID of the hardware thread.
+ */
+void rtc_clear_ipi(word_t hartid);
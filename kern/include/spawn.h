@@ -0,0 +1,71 @@
+#pragma once
+
+#include "types.h"
+
+#define SPAWN_MAX_MEM 8 ///< Memory regions of a spawn descriptor.
+#define SPAWN_MAX_IPC 4 ///< IPC capabilities granted by a spawn descriptor.
+#define SPAWN_MAX_REG 8 ///< Registers set by a spawn descriptor.
+
+/**
+ * Memory region of a spawned process, derived from a memory capability of the caller.
+ */
+typedef struct spawn_mem {
+	word_t parent; ///< Index of the caller's memory capability to derive from.
+	word_t csize;  ///< Fuel of the derived capability.
+	word_t rwx;    ///< Permissions of the derived capability.
+	word_t base;   ///< Base address of the derived capability.
+	word_t size;   ///< Size of the derived capability.
+	word_t slot;   ///< PMP slot of the spawned process, 0 to leave the region unmapped.
+	word_t mode;   ///< PMP mode and permissions, as for mem_pmp_set.
+	word_t addr;   ///< PMP address, the bottom address for TOR.
+	word_t top;    ///< PMP top address for TOR.
+	word_t index;  ///< Receives the index of the derived capability.
+} spawn_mem_t;
+
+/**
+ * Descriptor of a spawned process, read from and written back to the caller's memory.
+ * All words, so the layout is the same for the kernel and the library.
+ */
+typedef struct spawn {
+	word_t nmem; ///< Number of memory regions.
+	word_t nipc; ///< Number of IPC capabilities to grant.
+	word_t nreg; ///< Number of registers to set.
+	word_t resume; ///< Resume the process if non-zero.
+	spawn_mem_t mem[SPAWN_MAX_MEM];
+	word_t ipc[SPAWN_MAX_IPC]; ///< Indices of the caller's IPC capabilities, the index is kept when granted.
+
+	struct {
+		word_t reg;   ///< Register number, as for mon_reg_set.
+		word_t value; ///< Initial value.
+	} reg[SPAWN_MAX_REG];
+
+	struct {
+		word_t parent;	///< Index of the caller's time slice capability to derive from.
+		word_t csize;	///< Fuel of the derived capability, 0 for no time slice.
+		word_t enabled; ///< Enable the time slots.
+		word_t size;	///< Number of time slots.
+		word_t index;	///< Receives the index of the derived capability.
+	} tsl;
+} spawn_t;
+
+/**
+ * Builds a process from a descriptor in a single operation.
+ *
+ * Derives and maps the memory regions, grants the IPC capabilities, derives the time
+ * slice, sets the registers and resumes the process monitored by capability i. The
+ * process must be suspended, and the monitor capability and registers are checked before
+ * anything is changed. If a step fails, the steps before it are undone: the registers are
+ * restored, the time slice is revoked, the derived memory capabilities are deleted and
+ * their fuel is reclaimed, and the IPC capabilities are granted back.
+ *
+ * @param owner The process ID of the caller.
+ * @param i The index of the caller's monitor capability of the process.
+ * @param desc The descriptor, the indices of the derived capabilities are written back.
+ * @return ERR_SUCCESS if the process was built,
+ *         ERR_INVALID_ACCESS if the monitor capability is invalid,
+ *         ERR_INVALID_ARGUMENT if the descriptor has too many entries or an invalid register,
+ *         ERR_INVALID_STATE if the process is not suspended, or is running or waiting,
+ *         ERR_INVALID_STATE in multikernel builds if the process or time slice belongs to another hart,
+ *         or the error of the failing derivation, PMP configuration, grant, register write or resume.
+ */
+int spawn(pid_t owner, index_t i, spawn_t *desc);
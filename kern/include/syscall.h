@@ -9,3 +9,13 @@
  * Returns NULL if the scheduler should be invoked.
  */
 proc_t *syscall_handler(void);
+
+#ifdef MULTIKERNEL
+/**
+ * Services the system calls forwarded to this hart.
+ * Called on every kernel entry that reaches the system call handler or the scheduler.
+ *
+ * @return true if a request waits for its process to be switched out by its hart, false otherwise.
+ */
+bool syscall_drain(void);
+#endif
@@ -8,6 +8,10 @@
  *
  * This structure defines a time slice capability, which includes information about the owner,
  * the amount of cfree (both remaining and initial), and the time range associated with the capability.
+ *
+ * Capabilities on different harts covering the same time slots can be linked into a gang.
+ * Members of a gang derive aligned children together and are enabled or disabled together by
+ * their common owner, so the processes of the members are co-scheduled across the harts.
  */
 typedef struct {
 	pid_t owner;	  ///< Process ID of the owner of the capability.
@@ -18,6 +22,7 @@ typedef struct {
 	time_slot_t base; ///< Start address of the time slots.
 	time_slot_t size; ///< End address of the time slots.
 	time_slot_t free; ///< Start of the allocated region.
+	uint16_t gang;	  ///< Next member of the gang, the capability itself if not in a gang.
 } __attribute__((aligned(16))) tsl_t;
 
 void tsl_init();
@@ -34,9 +39,21 @@ void tsl_init();
  */
 bool tsl_valid_access(pid_t owner, index_t i);
 
+/**
+ * Retrieves the hart of a time slice capability.
+ *
+ * @param owner The owner of the capability.
+ * @param i The index of the capability.
+ * @return The hart of the capability, or ERR_INVALID_ACCESS if the owner does not match the entry in the time table.
+ */
+int tsl_get_hart(pid_t owner, index_t i);
+
 /**
  * Transfer a time slice capability from one process to another.
  *
+ * The new owner runs in the time slots. A member of a gang stays in its gang and with its owner,
+ * only the process run in its time slots changes, so the gang can co-schedule distinct processes.
+ *
  * @param owner The process ID of the current owner of the time slice capability.
  * @param index The index in the time table of the capability to be transferred.
  * @param new_owner The process ID of the new owner of the time slice capability.
@@ -72,6 +89,9 @@ int tsl_introspect(pid_t owner, index_t i, fuel_t offset, tsl_t *cap);
 /**
  * Derives a new time slice capability from an existing one.
  *
+ * If the capability is in a gang, all members derive the same time slots and
+ * the children form a new gang. All members must be owned by the owner.
+ *
  * @param owner The process ID associated with the existing time slice capability.
  * @param index The index in the time table of the existing capability.
  * @param child_pid The process ID for the new capability.
@@ -80,7 +100,7 @@ int tsl_introspect(pid_t owner, index_t i, fuel_t offset, tsl_t *cap);
  * @param child_end The end address of the new capability's time slots.
  * @return The index of the new time slice capability if successfully derived,
  *         ERR_INVALID_ACCESS if the owner does not match the entry in the time table,
- *         ERR_INVALID_ARGUMENT if the new time slice capability cannot be derived.
+ *         ERR_INVALID_ARGUMENT if the new time slice capability cannot be derived on every gang member.
  */
 int tsl_derive(pid_t owner, index_t i, pid_t child_pid, fuel_t child_fuel, bool child_enabled, time_slot_t child_size);
 
@@ -89,11 +109,46 @@ int tsl_derive(pid_t owner, index_t i, pid_t child_pid, fuel_t child_fuel, bool
  *
  * @param owner The process ID associated with the time slice capability.
  * @param index The index in the time table.
+ * The children are revoked in constant time, their time slots are reclaimed before it returns.
+ * The children of the other members of the capability's gang are revoked too.
+ *
  * @return ERR_SUCCESS if the time slice capability is successfully revoked,
- *         ERR_INVALID_ACCESS if the owner does not match the entry in the time table.
+ *         ERR_INVALID_ACCESS if the owner does not match the entry of a gang member in the time table,
+ *         the number of unrevoked capabilities if preempted while the revocation log was full.
  */
 int tsl_revoke(pid_t owner, index_t i);
 
+/**
+ * Reclaims the fuel and time slots of deleted children without revoking the live ones.
+ *
+ * Returns the fuel and time slots of dead children at the allocation frontier to the capability,
+ * stopping at the first child whose subtable still holds a live capability.
+ * The other members of the capability's gang reclaim too.
+ *
+ * @param owner The process ID associated with the time slice capability.
+ * @param index The index in the time table.
+ * @return The reclaimed fuel,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry of a gang member in the time table.
+ */
+int tsl_reclaim(pid_t owner, index_t i);
+
+/**
+ * Revokes a single child and its subtree, leaving the other children untouched.
+ *
+ * The subtree is revoked in constant time, its time slots become an idle frame before it returns.
+ * The frames of the siblings are not touched. In a gang, the child with the same time slots is
+ * revoked on every member.
+ *
+ * @param owner The process ID associated with the time slice capability.
+ * @param i The index of the parent in the time table.
+ * @param j The index of the child, it must be a child of i and not a grandchild.
+ * @return ERR_SUCCESS if the child is revoked, its fuel is merged back if it was at the allocation frontier,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry of a gang member in the time table,
+ *         ERR_INVALID_ARGUMENT if j is not a child of i, or a gang member has no child with its time slots,
+ *         the number of unrevoked capabilities if preempted while the revocation log was full.
+ */
+int tsl_revoke_child(pid_t owner, index_t i, index_t j);
+
 /**
  * Deletes a time slice capability by invalidating its process ID.
  *
@@ -107,10 +162,52 @@ int tsl_delete(pid_t owner, index_t i);
 /**
  * Enables or disables a time slice capability in the scheduler.
  *
+ * All members of the capability's gang are enabled or disabled, they must all belong to the owner.
+ *
  * @param owner The process ID associated with the time slice capability.
  * @param index The index in the time table.
  * @param enable True to enable the time slice capability, false to disable it.
  * @return ERR_SUCCESS if the time slice capability is successfully enabled or disabled,
- *         ERR_INVALID_ACCESS if the owner does not match the entry in the time table.
+ *         ERR_INVALID_ACCESS if the owner does not match the entry of a gang member in the time table.
  */
 int tsl_set(pid_t owner, index_t i, bool enable);
+
+/**
+ * Adds a time slice capability to the gang of another.
+ *
+ * @param owner The process ID associated with both time slice capabilities.
+ * @param i The index of a capability in the gang.
+ * @param j The index of the capability joining the gang.
+ * @return ERR_SUCCESS if the capability joined the gang,
+ *         ERR_INVALID_ACCESS if the owner does not match either entry in the time table,
+ *         ERR_INVALID_STATE if capability j is already in a gang, or in multikernel builds,
+ *         ERR_INVALID_ARGUMENT if the time slots or state differ, or the gang already has a member on j's hart.
+ */
+int tsl_gang_join(pid_t owner, index_t i, index_t j);
+
+/**
+ * Removes a time slice capability from its gang.
+ *
+ * @param owner The process ID associated with the time slice capability.
+ * @param i The index in the time table.
+ * @return ERR_SUCCESS if the capability left its gang,
+ *         ERR_INVALID_ACCESS if the owner does not match the entry in the time table.
+ */
+int tsl_gang_leave(pid_t owner, index_t i);
+
+/**
+ * Lists the time slice capabilities of a process.
+ *
+ * @param owner The process ID of the owner.
+ * @param buf Receives the indices of the capabilities, starting with the offset-th.
+ * @param count The maximum number of indices to write to buf.
+ * @param offset The number of capabilities to skip.
+ * @return The number of time slice capabilities owned by the process.
+ */
+word_t tsl_list(pid_t owner, index_t *buf, word_t count, word_t offset);
+
+/**
+ * Sweeps a bounded number of revoked time slice capabilities.
+ * Called on every system call, revoked capabilities are already unusable before they are swept.
+ */
+void tsl_sweep(void);
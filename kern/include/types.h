@@ -15,7 +15,7 @@ typedef uint16_t fuel_t; ///< Fuel type for capabilities.
 typedef uint16_t time_slot_t; ///< Slot type for scheduling.
 typedef uint8_t hart_t;	      ///< Hart ID type for hardware threads.
 
-typedef uint16_t index_t; ///< Index type for various tables.
+typedef uint32_t index_t; ///< Index type for various tables.
 
 typedef uint8_t pmp_slot_t; ///< PMP slot type for memory protection.
 
@@ -41,7 +41,9 @@ typedef uint8_t pmp_cfg_t;  ///< PMP configuration type.
 enum mem_perm {
 	MEM_PERM_NONE = 0x0, ///< No permission.
 	MEM_PERM_R = 0x1,    ///< Read-only permission.
+	MEM_PERM_W = 0x2,    ///< Write permission, only valid with read permission.
 	MEM_PERM_RW = 0x3,   ///< Read and write permission.
+	MEM_PERM_X = 0x4,    ///< Execute permission.
 	MEM_PERM_RX = 0x5,   ///< Read and execute permission.
 	MEM_PERM_RWX = 0x7,  ///< Read, write, and execute permission.
 };
@@ -62,6 +64,7 @@ typedef enum err {
 	ERR_INVALID_STATE = -3,	   ///< Invalid state.
 	ERR_SLOT_IN_USE = -4,	   ///< Slot already in use.
 	ERR_TIMEOUT = -5,	   ///< Timeout occurred.
+	ERR_PREEMPTED = -6,	   ///< Preempted before completion, the operation can be resumed.
 } err_t;
 
 /**
@@ -75,8 +78,9 @@ enum ipc_mode {
 	IPC_MODE_USYNC = 1,    ///< Unidirectional synchronous IPC.
 	IPC_MODE_BSYNC = 2,    ///< Bidirectional synchronous IPC.
 	IPC_MODE_ASYNC = 3,    ///< Asynchronous IPC.
-	IPC_MODE_MASK = 0x3,   ///< Mask for IPC modes.
-	IPC_MODE_REVOKE = 0x4, ///< Revoke flag for IPC.
+	IPC_MODE_NOTIFY = 4,   ///< Asynchronous notifications, badges are OR-ed into the sink's signal word.
+	IPC_MODE_MASK = 0x7,   ///< Mask for IPC modes.
+	IPC_MODE_REVOKE = 0x8, ///< Revoke flag for IPC.
 };
 
 typedef uint8_t ipc_mode_t;
@@ -87,7 +91,8 @@ enum ipc_flag {
 	IPC_FLAG_MEM = 4,     ///< Permission to send memory capability.
 	IPC_FLAG_MON = 8,     ///< Permission to send monitor capability.
 	IPC_FLAG_IPC = 16,    ///< Permission to send IPC capability.
-	IPC_FLAG_MASK = 0x1F, ///< Mask for IPC flags.
+	IPC_FLAG_QUEUE = 32,  ///< Calls to a busy receiver wait in a queue.
+	IPC_FLAG_MASK = 0x3F, ///< Mask for IPC flags.
 };
 
 typedef uint8_t ipc_flag_t;
@@ -117,13 +122,22 @@ typedef enum capty {
 #define TSL_TABLE_SIZE ((index_t)(_MAX_TIME_FUEL * _NUM_HARTS))	       ///< Maximum time index.
 #define MAX_MONITOR_FUEL ((fuel_t)_MAX_MONITOR_FUEL)		       ///< Maximum monitor capabilities.
 #define MON_TABLE_SIZE ((index_t)(MAX_MONITOR_FUEL * MAX_PID))	       ///< Maximum monitor index.
+#define MON_POOL_SIZE ((uint16_t)(_MAX_MONITOR_BLOCKS < _MAX_PID ? _MAX_MONITOR_BLOCKS : _MAX_PID)) ///< Monitor blocks.
 #define MAX_TIME_SLOT ((time_slot_t)_MAX_TIME_SLOT)		       ///< Maximum time slot constant.
 #define MAX_IPC_FUEL ((fuel_t)_MAX_IPC_FUEL)			       ///< Maximum IPC capabilities.
 #define IPC_TABLE_SIZE ((index_t)(MAX_IPC_FUEL))		       ///< Maximum IPC index.
+#define MAX_IPC_QUEUE ((word_t)_MAX_IPC_QUEUE)			       ///< Messages queued per asynchronous sink.
+#define IPC_QUEUE_POOL_SIZE ((uint16_t)(_MAX_IPC_QUEUES < _MAX_IPC_FUEL ? _MAX_IPC_QUEUES : _MAX_IPC_FUEL)) ///< Message queues.
 #define NUM_HARTS ((hart_t)_NUM_HARTS)				       ///< Number of harts constant.
 #if _NUM_HARTS > 1
 #define SMP
 #endif
+#if _MULTIKERNEL
+#define MULTIKERNEL ///< Per-hart kernel instances, cross-hart system calls are forwarded.
+#endif
+#if _CAP_SOA
+#define CAP_SOA ///< Capability owners are stored apart from the capability tables.
+#endif
 #define RTC_HZ ((uint32_t)_RTC_HZ)				      ///< RTC frequency constant.
 #define TICKS_PER_US ((uint32_t)(RTC_HZ / 1000000))		      ///< RTC ticks per microsecond constant.
 #define TIME_SLOT_US ((uint32_t)_TIME_SLOT_US)			      ///< Time slot duration constant in microseconds.
@@ -0,0 +1,144 @@
+#include "chan.h"
+
+#include "csr.h"
+#include "ipc.h"
+#include "macro.h"
+#include "mem.h"
+#include "mon.h"
+#include "proc.h"
+
+#define CHAN_MAX_MEM 3 ///< The buffer of each end and the consumer's region.
+
+/**
+ * Capabilities created by a channel, recorded in the kernel so rollback does not
+ * depend on the descriptor, which the caller's memory may change.
+ */
+typedef struct {
+	word_t nmem;
+	pid_t target[CHAN_MAX_MEM];
+	index_t child[CHAN_MAX_MEM];
+	pid_t producer, consumer;
+	int sink, source;
+	bool granted;
+} _undo_t;
+
+/**
+ * Undoes a partial channel in reverse order.
+ * Each deleted child is then at its parent's allocation frontier, so reclaiming returns all of its fuel.
+ */
+static void _rollback(pid_t owner, index_t mem, index_t ipc, _undo_t *undo)
+{
+	if (undo->source >= 0) {
+		ipc_delete(undo->producer, undo->source);
+	}
+	if (undo->sink >= 0) {
+		ipc_delete(undo->granted ? undo->consumer : owner, undo->sink);
+		ipc_reclaim(owner, ipc);
+	}
+	while (undo->nmem > 0) {
+		undo->nmem--;
+		mem_delete(undo->target[undo->nmem], undo->child[undo->nmem]);
+		mem_reclaim(owner, mem);
+	}
+}
+
+/**
+ * Derives a memory capability of [base, base + size) for an end of a channel and maps it.
+ */
+static int _chan_mem(pid_t owner, index_t mem, pid_t target, mem_perm_t rwx, word_t base, word_t size,
+		     chan_map_t *map, _undo_t *undo)
+{
+	int j = mem_derive(owner, mem, target, 1, rwx, base, size);
+	if (j < 0)
+		return j;
+	undo->target[undo->nmem] = target;
+	undo->child[undo->nmem] = j;
+	undo->nmem++;
+	map->mem = j;
+	if (map->slot != 0) {
+		int err = mem_pmp_set(target, j, map->slot, (map->mode & PMP_MODE_NAPOT) | rwx, map->addr, map->top);
+		if (err < 0)
+			return err;
+	}
+	return ERR_SUCCESS;
+}
+
+/**
+ * Derives the notification sink of the consumer and the source of the producer.
+ * The sink is derived for the caller, so it can derive the source, and then granted.
+ */
+static int _chan_ipc(pid_t owner, index_t ipc, word_t badge, _undo_t *undo)
+{
+	undo->sink = ipc_derive(owner, ipc, owner, 2, IPC_MODE_NOTIFY, 0, 0);
+	if (undo->sink < 0)
+		return undo->sink;
+	undo->source = ipc_derive(owner, undo->sink, undo->producer, 1, IPC_MODE_NOTIFY, 0, badge);
+	if (undo->source < 0)
+		return undo->source;
+	int err = ipc_transfer(owner, undo->sink, undo->consumer);
+	if (err < 0)
+		return err;
+	undo->granted = true;
+	return ERR_SUCCESS;
+}
+
+/**
+ * Establishes a shared-memory channel from a descriptor.
+ */
+int chan_create(pid_t owner, chan_t *desc)
+{
+	pid_t producer = mon_get_pid(owner, desc->prod.mon);
+	pid_t consumer = mon_get_pid(owner, desc->cons.mon);
+	if (UNLIKELY(producer == INVALID_PID || consumer == INVALID_PID)) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	index_t mem = desc->mem;
+	index_t ipc = desc->ipc;
+	word_t base = desc->base;
+	word_t size = desc->size;
+	word_t ack_size = desc->ack_size;
+	if (UNLIKELY(producer == consumer || ack_size > size)) {
+		return ERR_INVALID_ARGUMENT;
+	}
+
+#ifdef MULTIKERNEL
+	// The ends must belong to this hart, as for a spawn.
+	word_t hartid = csrr_mhartid();
+	if (UNLIKELY(proc_hart(producer) != hartid || (producer != owner && proc_is_forwarded(producer)))) {
+		return ERR_INVALID_STATE;
+	}
+	if (UNLIKELY(proc_hart(consumer) != hartid || (consumer != owner && proc_is_forwarded(consumer)))) {
+		return ERR_INVALID_STATE;
+	}
+#endif
+
+	// Every step is undone if a later step fails.
+	chan_map_t prod = desc->prod.buf;
+	chan_map_t cons = desc->cons.buf;
+	chan_map_t ack = desc->ack;
+	_undo_t undo = {.producer = producer, .consumer = consumer, .sink = -1, .source = -1};
+	int err = _chan_mem(owner, mem, producer, MEM_PERM_RW, base, size, &prod, &undo);
+	if (err == ERR_SUCCESS) {
+		err = _chan_mem(owner, mem, consumer, MEM_PERM_R, base, size, &cons, &undo);
+	}
+	if (err == ERR_SUCCESS && ack_size > 0) {
+		err = _chan_mem(owner, mem, consumer, MEM_PERM_RW, base, ack_size, &ack, &undo);
+	}
+	if (err == ERR_SUCCESS) {
+		err = _chan_ipc(owner, ipc, desc->badge, &undo);
+	}
+	if (err < 0) {
+		_rollback(owner, mem, ipc, &undo);
+		return err;
+	}
+
+	desc->prod.buf.mem = prod.mem;
+	desc->prod.ipc = undo.source;
+	desc->cons.buf.mem = cons.mem;
+	desc->cons.ipc = undo.sink;
+	if (ack_size > 0) {
+		desc->ack.mem = ack.mem;
+	}
+	return ERR_SUCCESS;
+}
@@ -1,6 +1,9 @@
 #include "exception.h"
 
 #include "current.h"
+#include "lock.h"
+#include "mem.h"
+#include "proc.h"
 
 enum exception_cause {
 	INSTRUCTION_ADDRESS_MISALIGNED = 0,
@@ -52,12 +55,43 @@ proc_t *_handle_delegate(word_t cause, word_t tval)
 	return current;
 }
 
+/**
+ * Handles a PMP access fault by installing a capability mapped on demand.
+ * On success the faulting instruction is retried, otherwise the fault is delegated.
+ */
+proc_t *_handle_access_fault(word_t cause, word_t tval, mem_perm_t rwx)
+{
+	// Try to acquire a lock. Also checks for preemption, the instruction faults again when resumed.
+	if (!lock_acquire(true)) {
+		return NULL;
+	}
+	bool installed = mem_fault(current->pid, tval, rwx);
+	lock_release();
+
+	if (!installed) {
+		return _handle_delegate(cause, tval);
+	}
+	// The PMP registers are only reloaded when switching process.
+	proc_pmp_load(current->pid);
+	return current;
+}
+
 proc_t *exception_handler(word_t cause, word_t tval)
 {
 	// If mret instruction
 	if (cause == ILLEGAL_INSTRUCTION && tval == MRET) {
 		return _handle_mret();
 	}
+	// If access fault, possibly on a capability mapped on demand
+	if (cause == INSTRUCTION_ACCESS_FAULT) {
+		return _handle_access_fault(cause, tval, MEM_PERM_X);
+	}
+	if (cause == LOAD_ACCESS_FAULT) {
+		return _handle_access_fault(cause, tval, MEM_PERM_R);
+	}
+	if (cause == STORE_AMO_ACCESS_FAULT) {
+		return _handle_access_fault(cause, tval, MEM_PERM_W);
+	}
 	// If not mret instruction
 	return _handle_delegate(cause, tval);
 }
@@ -1,12 +1,32 @@
 #include "interrupt.h"
 
+#include "csr.h"
+#include "current.h"
+#include "rtc.h"
+
+/**
+ * Machine software interrupt, the interrupt bit of mcause is dropped.
+ */
+#define MACHINE_SOFTWARE_INTERRUPT 3
+
 /**
- * Dummy interrupt handler.
+ * Interrupt handler.
  */
 proc_t *interrupt_handler(word_t cause, word_t tval)
 {
-	(void)cause;
 	(void)tval;
+#ifdef MULTIKERNEL
+	if ((cause << 1) == (MACHINE_SOFTWARE_INTERRUPT << 1)) {
+		// Another hart shot down PMP entries, reload them and resume the process.
+		// Forwarded calls are serviced at the next switch.
+		rtc_clear_ipi(csrr_mhartid());
+		proc_pmp_sync();
+		proc_pmp_load(current->pid);
+		return current;
+	}
+#else
+	(void)cause;
+#endif
 	// Returning NULL invokes the scheduler later.
 	return NULL;
 }
@@ -1,28 +1,201 @@
 #include "ipc.h"
 
+#include "csr.h"
 #include "current.h"
 #include "macro.h"
 #include "mem.h"
 #include "mon.h"
+#include "owner.h"
 #include "preempt.h"
+#include "revoke.h"
 #include "rtc.h"
 #include "tsl.h"
+#include "ttas.h"
 
 /**
  * Table of IPC capabilities.
  */
 static ipc_t ipc_table[IPC_TABLE_SIZE];
 
+#ifdef CAP_SOA
+/**
+ * Owners of the IPC capabilities, kept apart from the table so ownership checks and sweeps
+ * stream through a dense array. The owner fields of the table entries are unused.
+ */
+static pid_t ipc_owners[IPC_TABLE_SIZE];
+#endif
+
+/**
+ * The owner of the IPC capability at index i.
+ */
+static inline pid_t *_owner(index_t i)
+{
+#ifdef CAP_SOA
+	return &ipc_owners[i];
+#else
+	return &ipc_table[i].owner;
+#endif
+}
+
+/**
+ * Message queue of an asynchronous sink, a ring buffer of MAX_IPC_QUEUE words.
+ */
+typedef struct ipc_queue {
+	word_t msg[MAX_IPC_QUEUE];
+	uint16_t head;	///< Index of the oldest message.
+	uint16_t count; ///< Number of queued messages.
+} ipc_queue_t;
+
+#define IPC_NO_QUEUE ((uint16_t)-1) ///< The capability is not an asynchronous sink.
+
+/**
+ * Pool of message queues, allocated when an asynchronous sink is derived and released when it is
+ * deleted or swept, so other capabilities take no queue storage.
+ */
+static ipc_queue_t ipc_queues[IPC_QUEUE_POOL_SIZE];
+
+/**
+ * Queue in the pool of each asynchronous sink.
+ */
+static uint16_t ipc_queue_of[IPC_TABLE_SIZE];
+
+/**
+ * Stack of free queues in the pool.
+ */
+static uint16_t ipc_queue_free[IPC_QUEUE_POOL_SIZE];
+static uint16_t ipc_queue_nfree;
+
+#ifdef MULTIKERNEL
+/**
+ * Sinks on different harts share the pool.
+ */
+static ttas_t ipc_queue_lock;
+#endif
+
+/**
+ * Membership of a sink in an endpoint set, a circular list like the gangs of time slices.
+ */
+typedef struct ipc_set {
+	uint16_t next; ///< Next member of the set, the sink itself if not in a set.
+	bool waiting;  ///< The owner's last wait on the sink covers the whole set.
+} ipc_set_t;
+
+/**
+ * Endpoint sets, indexed by sink.
+ */
+static ipc_set_t ipc_sets[IPC_TABLE_SIZE];
+
+/**
+ * Calls on the sources of a sink, waiting for a busy server in a FIFO for each sink with IPC_FLAG_QUEUE,
+ * or in service until the server uses its reply capability. Indices are stored plus one, so
+ * zero-initialized entries are empty.
+ */
+typedef struct ipc_callers {
+	uint16_t head;	  ///< First waiting source, for a sink.
+	uint16_t tail;	  ///< Last waiting source, for a sink.
+	uint16_t next;	  ///< Next waiting source, for a source in a queue.
+	bool queued;	  ///< The source is in the queue of its sink.
+	bool reply;	  ///< The owner of the sink holds a one-shot reply capability for the call on the source.
+	uint64_t timeout; ///< Timeout of the caller when it joined the queue, for a source in a queue.
+} ipc_callers_t;
+
+/**
+ * Caller queues, indexed by sink and by source.
+ */
+static ipc_callers_t ipc_callers[IPC_TABLE_SIZE];
+
+/**
+ * Destination of a bulk copy, registered by the receiver of a BSYNC sink in ipc_recv, and the
+ * progress of the copy into it. Source indices are stored plus one, so zero-initialized entries are empty.
+ */
+typedef struct ipc_copy {
+	word_t base;	 ///< Start address of the destination.
+	word_t size;	 ///< Size of the destination, 0 if none is registered.
+	word_t done;	 ///< Bytes copied by the copy in progress.
+	index_t mem;	 ///< The receiver's memory capability of the destination.
+	uint16_t source; ///< Source of the copy in progress.
+} ipc_copy_t;
+
+/**
+ * Bulk copy destinations, indexed by sink.
+ */
+static ipc_copy_t ipc_copies[IPC_TABLE_SIZE];
+
+/**
+ * Pending revocations of the IPC table.
+ */
+static revoke_log_t ipc_revoked;
+
+/**
+ * Ownership lists of the IPC table.
+ */
+static owner_link_t ipc_links[IPC_TABLE_SIZE];
+static owner_index_t ipc_owned;
+
+/**
+ * The ownership links of an IPC capability.
+ */
+static owner_link_t *_link(index_t i)
+{
+	return &ipc_links[i];
+}
+
 /**
  * Initialize the IPC capabilities.
  */
 void ipc_init(void)
 {
 	ipc_table[0] = (ipc_t){
-		.owner = 1,
 		.cfree = MAX_IPC_FUEL,
 		.csize = MAX_IPC_FUEL,
 	};
+	*_owner(0) = 1;
+	owner_set(&ipc_owned, 0, 1, _link);
+	for (index_t i = 0; i < IPC_TABLE_SIZE; ++i) {
+		ipc_sets[i].next = i;
+		ipc_queue_of[i] = IPC_NO_QUEUE;
+	}
+	for (uint16_t q = 0; q < IPC_QUEUE_POOL_SIZE; ++q) {
+		ipc_queue_free[q] = q;
+	}
+	ipc_queue_nfree = IPC_QUEUE_POOL_SIZE;
+}
+
+/**
+ * Allocates an empty message queue for the asynchronous sink at index i.
+ */
+static bool _queue_alloc(index_t i)
+{
+#ifdef MULTIKERNEL
+	ttas_acquire(&ipc_queue_lock, false);
+#endif
+	if (ipc_queue_nfree > 0)
+		ipc_queue_of[i] = ipc_queue_free[--ipc_queue_nfree];
+#ifdef MULTIKERNEL
+	ttas_release(&ipc_queue_lock);
+#endif
+	if (ipc_queue_of[i] == IPC_NO_QUEUE)
+		return false;
+	ipc_queues[ipc_queue_of[i]].head = 0;
+	ipc_queues[ipc_queue_of[i]].count = 0;
+	return true;
+}
+
+/**
+ * Returns the message queue of the capability at index i to the pool, if it has one.
+ */
+static void _queue_free(index_t i)
+{
+	if (ipc_queue_of[i] == IPC_NO_QUEUE)
+		return;
+#ifdef MULTIKERNEL
+	ttas_acquire(&ipc_queue_lock, false);
+#endif
+	ipc_queue_free[ipc_queue_nfree++] = ipc_queue_of[i];
+#ifdef MULTIKERNEL
+	ttas_release(&ipc_queue_lock);
+#endif
+	ipc_queue_of[i] = IPC_NO_QUEUE;
 }
 
 /**
@@ -30,7 +203,153 @@ void ipc_init(void)
  */
 bool ipc_valid_access(pid_t owner, index_t i)
 {
-	return i < ARRAY_SIZE(ipc_table) && ipc_table[i].owner == owner;
+	return i < ARRAY_SIZE(ipc_table) && *_owner(i) == owner && !revoke_stale(&ipc_revoked, i);
+}
+
+/**
+ * Removes a sink from its endpoint set.
+ */
+static void _set_unlink(index_t i)
+{
+	index_t k = i;
+	while (ipc_sets[k].next != i)
+		k = ipc_sets[k].next;
+	ipc_sets[k].next = ipc_sets[i].next;
+	ipc_sets[i].next = i;
+}
+
+/**
+ * Checks if sink j is in the endpoint set of sink i.
+ */
+static bool _set_contains(index_t i, index_t j)
+{
+	index_t k = i;
+	do {
+		if (k == j)
+			return true;
+		k = ipc_sets[k].next;
+	} while (k != i);
+	return false;
+}
+
+/**
+ * Appends source i to the caller queue of its sink.
+ */
+static void _callers_push(index_t sink, index_t i)
+{
+	ipc_callers[i].next = 0;
+	ipc_callers[i].queued = true;
+	if (ipc_callers[sink].tail)
+		ipc_callers[ipc_callers[sink].tail - 1].next = i + 1;
+	else
+		ipc_callers[sink].head = i + 1;
+	ipc_callers[sink].tail = i + 1;
+}
+
+/**
+ * Removes the first source from the caller queue of a sink.
+ */
+static bool _callers_pop(index_t sink, index_t *i)
+{
+	if (!ipc_callers[sink].head)
+		return false;
+	*i = ipc_callers[sink].head - 1;
+	ipc_callers[sink].head = ipc_callers[*i].next;
+	if (!ipc_callers[sink].head)
+		ipc_callers[sink].tail = 0;
+	ipc_callers[*i].next = 0;
+	ipc_callers[*i].queued = false;
+	return true;
+}
+
+/**
+ * Removes source i from the caller queue it waits in.
+ */
+static void _callers_remove(index_t i)
+{
+	if (!ipc_callers[i].queued)
+		return;
+	index_t sink = ipc_table[i].sink;
+	index_t prev = 0;
+	index_t k = ipc_callers[sink].head;
+	while (k != i + 1) {
+		prev = k;
+		k = ipc_callers[k - 1].next;
+	}
+	if (prev)
+		ipc_callers[prev - 1].next = ipc_callers[i].next;
+	else
+		ipc_callers[sink].head = ipc_callers[i].next;
+	if (ipc_callers[sink].tail == i + 1)
+		ipc_callers[sink].tail = prev;
+	ipc_callers[i].next = 0;
+	ipc_callers[i].queued = false;
+}
+
+/**
+ * Wakes the caller blocked on source i with an error.
+ */
+static void _caller_fail(index_t i, int err)
+{
+	pid_t caller = *_owner(i);
+	if (caller != INVALID_PID && proc_ipc_acquire(caller, i)) {
+		proc_t *proc = proc_get(caller);
+		proc->regs.a0 = err;
+		// Set timeout to 0 so it can be scheduled as soon as possible.
+		proc->timeout = 0;
+		proc_release(caller);
+	}
+}
+
+/**
+ * Unbinds the copy destination held by source i, when the source is deleted, revoked or transferred.
+ */
+static void _copy_release(index_t i)
+{
+	ipc_copy_t *copy = &ipc_copies[ipc_table[i].sink];
+	if (copy->source == i + 1) {
+		copy->source = 0;
+		copy->done = 0;
+	}
+}
+
+/**
+ * Fails the call on source i, if it waits or is in service, when the source is deleted, revoked or transferred.
+ */
+static void _callers_cancel(index_t i)
+{
+	if (ipc_callers[i].queued || ipc_callers[i].reply) {
+		_callers_remove(i);
+		ipc_callers[i].reply = false;
+		_caller_fail(i, ERR_INVALID_STATE);
+	}
+}
+
+/**
+ * Fails the calls waiting for or in service at a sink that is deleted or revoked.
+ * Sources are derived from their sink, so they are in its subtable.
+ */
+static void _callers_flush(index_t sink)
+{
+	if (ipc_table[sink].mode == IPC_MODE_NONE || ipc_table[sink].sink != sink)
+		return;
+	for (index_t k = sink + 1; k < sink + ipc_table[sink].csize; ++k) {
+		if (ipc_table[k].sink == sink)
+			_callers_cancel(k);
+	}
+}
+
+/**
+ * Invalidates a stale IPC capability.
+ */
+static void _sweep(index_t i)
+{
+	_callers_cancel(i);
+	_callers_flush(i);
+	_copy_release(i);
+	_queue_free(i);
+	*_owner(i) = INVALID_PID;
+	_set_unlink(i);
 }
 
 /**
@@ -67,7 +386,12 @@ static bool _valid_capability_send(pid_t owner, index_t i, capty_t capty, ipc_fl
 	case CAPTY_MEM:
 		return (flag & IPC_FLAG_MEM) && mem_valid_access(owner, i);
 	case CAPTY_TSL:
+#ifdef MULTIKERNEL
+		// The schedule of the time slice must belong to the hart servicing the IPC.
+		return (flag & IPC_FLAG_TSL) && tsl_get_hart(owner, i) == (int)csrr_mhartid();
+#else
 		return (flag & IPC_FLAG_TSL) && tsl_valid_access(owner, i);
+#endif
 	case CAPTY_MON:
 		return (flag & IPC_FLAG_MON) && mon_valid_access(owner, i);
 	case CAPTY_IPC:
@@ -77,6 +401,56 @@ static bool _valid_capability_send(pid_t owner, index_t i, capty_t capty, ipc_fl
 	}
 }
 
+/**
+ * Check if flags and access rights permit sending all capabilities of a message.
+ */
+static bool _valid_msg_send(pid_t owner, const ipc_msg_t *msg, ipc_flag_t flag)
+{
+	for (int k = 0; k < IPC_MSG_CAPS; ++k) {
+		if (!_valid_capability_send(owner, msg->cap[k], msg->capty[k], flag)) {
+			return false;
+		}
+		// A capability is sent at most once.
+		for (int l = 0; l < k; ++l) {
+			if (msg->capty[k] != CAPTY_NONE && msg->capty[k] == msg->capty[l] && msg->cap[k] == msg->cap[l]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Checks if the owner holds the reply capability for the call on source i.
+ */
+static bool _reply_valid_access(pid_t owner, index_t i)
+{
+	return i < ARRAY_SIZE(ipc_table) && ipc_callers[i].reply && *_owner(i) != INVALID_PID
+	       && !revoke_stale(&ipc_revoked, i) && ipc_valid_access(owner, ipc_table[i].sink);
+}
+
+/**
+ * Retrieves the process an invocation of the IPC capability is delivered to.
+ */
+pid_t ipc_get_peer(pid_t owner, index_t i)
+{
+	if (_reply_valid_access(owner, i)) {
+		// Reply capability, the client owns the source.
+		return *_owner(i);
+	}
+	if (UNLIKELY(!ipc_valid_access(owner, i))) {
+		return INVALID_PID;
+	}
+	index_t sink = ipc_table[i].sink;
+	if (sink != i) {
+		// Source capability, the receiver owns the sink.
+		return *_owner(sink);
+	}
+	// Sink capability, the client owns the source being replied to.
+	index_t source = ipc_table[i].source;
+	return (source != i) ? *_owner(source) : INVALID_PID;
+}
+
 /**
  * Transfer an IPC capability from one process to another.
  */
@@ -85,7 +459,12 @@ int ipc_transfer(pid_t owner, index_t i, pid_t new_owner)
 	if (UNLIKELY(!ipc_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
 	}
-	ipc_table[i].owner = new_owner;
+	// An endpoint set belongs to one process, a waiting call belongs to the process that made it.
+	_set_unlink(i);
+	_callers_cancel(i);
+	_copy_release(i);
+	*_owner(i) = new_owner;
+	owner_set(&ipc_owned, i, new_owner, _link);
 	return ERR_SUCCESS;
 }
 
@@ -100,13 +479,17 @@ int ipc_introspect(pid_t owner, index_t i, fuel_t offset, ipc_t *cap)
 	}
 
 	*cap = ipc_table[i + offset];
+	cap->owner = *_owner(i + offset);
+	if (revoke_stale(&ipc_revoked, i + offset)) {
+		cap->owner = INVALID_PID;
+	}
 	return ERR_SUCCESS;
 }
 
 /**
  * Derive a new IPC capability.
  */
-int ipc_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, ipc_mode_t mode, ipc_flag_t flag)
+int ipc_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, ipc_mode_t mode, ipc_flag_t flag, uint32_t badge)
 {
 	if (UNLIKELY(!ipc_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
@@ -121,23 +504,43 @@ int ipc_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, ipc_mode_t mo
 		return ERR_INVALID_ARGUMENT;
 	}
 
+	// A notification source signals with its badge, a sink starts without pending signals.
+	bool source = ipc_table[i].mode != IPC_MODE_NONE;
+	if (!source || mode != IPC_MODE_NOTIFY) {
+		badge = 0;
+	}
+
 	// Subtract delegated capability size from cfree.
 	ipc_table[i].cfree -= csize;
 
 	// Calculate the new index for the derived capability.
 	index_t j = i + ipc_table[i].cfree;
 
+	// Invalidate a revoked capability at the new index, the rest of the range stays stale.
+	revoke_claim(&ipc_revoked, j, _sweep);
+
+	// A new asynchronous sink starts with an empty queue from the pool.
+	if (!source && mode == IPC_MODE_ASYNC && UNLIKELY(!_queue_alloc(j))) {
+		ipc_table[i].cfree += csize;
+		return ERR_INVALID_STATE;
+	}
+
 	// Add the new IPC capability to the table.
 	ipc_table[j] = (ipc_t){
-		.owner = target,
 		.cfree = csize,
 		.csize = csize,
 		.mode = mode,
 		.flag = flag,
-		.sink = (ipc_table[i].mode == IPC_MODE_NONE) ? j : ipc_table[i].sink,
+		.sink = source ? ipc_table[i].sink : j,
 		.source = j,
-		.opt = 0,
+		.opt = badge,
 	};
+	*_owner(j) = target;
+	owner_set(&ipc_owned, j, target, _link);
+
+	ipc_sets[j] = (ipc_set_t){.next = j};
+	ipc_callers[j] = (ipc_callers_t){0};
+	ipc_copies[j] = (ipc_copy_t){0};
 
 	// Return the index of the new capability.
 	return j;
@@ -157,32 +560,107 @@ int ipc_revoke(pid_t owner, index_t i)
 		return ERR_INVALID_ARGUMENT;
 	}
 
-	// Revoke children of IPC capability.
+	if (ipc_table[i].cfree == ipc_table[i].csize) {
+		return 0;
+	}
+
+	// Record the children as revoked, returns false if preempted while the log was full.
+	index_t begin = i + ipc_table[i].cfree;
+	index_t end = i + ipc_table[i].csize;
+	if (UNLIKELY(!revoke_push(&ipc_revoked, begin, end, _sweep))) {
+		return ipc_table[i].csize - ipc_table[i].cfree;
+	}
+
+	// Reclaim the children's capability table.
+	ipc_table[i].cfree = ipc_table[i].csize;
+
+	return 0;
+}
+
+/**
+ * Check if the capabilities in [begin, end) are deleted or revoked.
+ */
+static bool _dead(index_t begin, index_t end)
+{
+	for (index_t k = begin; k < end; ++k) {
+		if (*_owner(k) != INVALID_PID && !revoke_stale(&ipc_revoked, k))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Check if j is a child of i, the children are laid out back to back from the allocation frontier.
+ */
+static bool _is_child(index_t i, index_t j)
+{
+	for (index_t k = i + ipc_table[i].cfree; k < i + ipc_table[i].csize; k += ipc_table[k].csize) {
+		if (k == j)
+			return true;
+		if (ipc_table[k].csize == 0)
+			return false;
+	}
+	return false;
+}
+
+/**
+ * Returns the fuel of dead children at the allocation frontier to capability i.
+ */
+static fuel_t _reclaim(index_t i)
+{
+	// Children are allocated downwards, so the most recent child is at the frontier.
+	fuel_t reclaimed = 0;
 	while (ipc_table[i].cfree < ipc_table[i].csize) {
-		// Get the next child index.
 		index_t j = i + ipc_table[i].cfree;
+		fuel_t csize = ipc_table[j].csize;
+		if (csize == 0 || csize > ipc_table[i].csize - ipc_table[i].cfree || !_dead(j, j + csize))
+			break;
+		ipc_table[i].cfree += csize;
+		reclaimed += csize;
+	}
+	return reclaimed;
+}
 
-		// Invalidate the child capability.
-		ipc_table[j].owner = INVALID_PID;
+/**
+ * Returns the fuel of dead children at the allocation frontier to an IPC capability.
+ */
+int ipc_reclaim(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!ipc_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
 
-		// Reclaim the child's capability table.
-		ipc_table[i].cfree += ipc_table[j].cfree;
+	// Like revoke, endpoints keep their children, a sink may still refer to a deleted source.
+	if ((ipc_table[i].mode & IPC_MODE_MASK) != IPC_MODE_NONE) {
+		return ERR_INVALID_ARGUMENT;
+	}
 
-		// Set revoke flag to prevent further derivations.
-		ipc_table[i].mode = IPC_MODE_REVOKE;
+	return _reclaim(i);
+}
 
-		// Check for preemption.
-		if (UNLIKELY(preempt()))
-			break;
+/**
+ * Revokes a single child of an IPC capability and its subtree.
+ */
+int ipc_revoke_child(pid_t owner, index_t i, index_t j)
+{
+	if (UNLIKELY(!ipc_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
 	}
 
-	if (ipc_table[i].cfree == ipc_table[i].csize) {
-		// Unset revoke flag if all children are revoked.
-		ipc_table[i].mode = IPC_MODE_NONE;
+	// Only non-endpoint IPC capabilities can revoke children.
+	if ((ipc_table[i].mode & IPC_MODE_MASK) != IPC_MODE_NONE || !_is_child(i, j)) {
+		return ERR_INVALID_ARGUMENT;
 	}
 
-	// Return number of unrevoked capability slots.
-	return ipc_table[i].csize - ipc_table[i].cfree;
+	// Record the subtree as revoked, returns false if preempted while the log was full.
+	if (UNLIKELY(!revoke_push(&ipc_revoked, j, j + ipc_table[j].csize, _sweep))) {
+		return ipc_table[j].csize;
+	}
+
+	// Merge the fuel back if the child was at the allocation frontier.
+	_reclaim(i);
+
+	return 0;
 }
 
 /**
@@ -194,28 +672,77 @@ int ipc_delete(pid_t owner, index_t i)
 		return ERR_INVALID_ACCESS;
 	}
 
-	// Invalidate the capability.
-	ipc_table[i].owner = INVALID_PID;
+	// Fail the calls waiting on the capability, then invalidate it.
+	_callers_cancel(i);
+	_callers_flush(i);
+	_copy_release(i);
+	_queue_free(i);
+	*_owner(i) = INVALID_PID;
+	owner_set(&ipc_owned, i, INVALID_PID, _link);
+	_set_unlink(i);
 
 	return ERR_SUCCESS;
 }
 
 /**
- * Send data and potentially a capability to the receiver.
- * For synchronous IPC only!
+ * Checks if a process invokes synchronous IPC with long messages.
  */
-static void do_send(pid_t receiver, word_t data[2], pid_t owner, capty_t capty, index_t i)
+static inline bool _msg_long(const proc_t *proc)
+{
+	return proc->regs.a7 > 2;
+}
+
+/**
+ * Packs a capability of a long message, capty | index << 8.
+ */
+static inline word_t _msg_cap_pack(capty_t capty, index_t i)
+{
+	return (capty == CAPTY_NONE) ? 0 : (capty | (word_t)i << 8);
+}
+
+/**
+ * Loads the message of a synchronous IPC invocation from the registers of its sender.
+ */
+void ipc_msg_get(const proc_t *proc, ipc_msg_t *msg)
+{
+	bool long_msg = _msg_long(proc);
+	msg->data[0] = proc->regs.a2;
+	msg->data[1] = proc->regs.a3;
+	msg->data[2] = long_msg ? proc->regs.t0 : 0;
+	msg->data[3] = long_msg ? proc->regs.t1 : 0;
+	msg->data[4] = long_msg ? proc->regs.t2 : 0;
+	msg->data[5] = long_msg ? proc->regs.t3 : 0;
+	msg->capty[0] = proc->regs.a4;
+	msg->cap[0] = proc->regs.a5;
+	word_t caps[IPC_MSG_CAPS - 1] = {proc->regs.t4, proc->regs.t5, proc->regs.t6};
+	for (int k = 1; k < IPC_MSG_CAPS; ++k) {
+		word_t cap = long_msg ? caps[k - 1] : 0;
+		msg->capty[k] = cap & 0xFF;
+		msg->cap[k] = cap >> 8;
+	}
+}
+
+/**
+ * Checks if the receiver takes all capabilities of a message, only a long receiver takes more than one.
+ */
+static bool _msg_fits(pid_t receiver, const ipc_msg_t *msg)
+{
+	if (_msg_long(proc_get(receiver))) {
+		return true;
+	}
+	for (int k = 1; k < IPC_MSG_CAPS; ++k) {
+		if (msg->capty[k] != CAPTY_NONE) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Transfers a capability sent in a message to the receiver.
+ */
+static void _capability_transfer(pid_t owner, capty_t capty, index_t i, pid_t receiver)
 {
-	// Send the data to the target process.
-	proc_t *proc = proc_get(receiver);
-	// Receiver has successfully received the data.
-	proc->regs.a0 = ERR_SUCCESS;
-	// Copy data.
-	proc->regs.a1 = data[0];
-	proc->regs.a2 = data[1];
-	// Copy capability information.
-	proc->regs.a3 = capty;
-	proc->regs.a4 = (capty == CAPTY_NONE) ? 0 : i;
 	switch (capty) {
 	case CAPTY_NONE:
 		break;
@@ -236,6 +763,37 @@ static void do_send(pid_t receiver, word_t data[2], pid_t owner, capty_t capty,
 	}
 }
 
+/**
+ * Send data and potentially capabilities to the receiver.
+ * For synchronous IPC only! The capabilities must be validated with _valid_msg_send and _msg_fits.
+ */
+static void do_send(pid_t receiver, const ipc_msg_t *msg, pid_t owner)
+{
+	// Send the data to the target process.
+	proc_t *proc = proc_get(receiver);
+	// Receiver has successfully received the data.
+	proc->regs.a0 = ERR_SUCCESS;
+	// Copy data, the rest of a long message only if the receiver takes it.
+	proc->regs.a1 = msg->data[0];
+	proc->regs.a2 = msg->data[1];
+	// Copy capability information.
+	proc->regs.a3 = msg->capty[0];
+	proc->regs.a4 = (msg->capty[0] == CAPTY_NONE) ? 0 : msg->cap[0];
+	if (_msg_long(proc)) {
+		proc->regs.t0 = msg->data[2];
+		proc->regs.t1 = msg->data[3];
+		proc->regs.t2 = msg->data[4];
+		proc->regs.t3 = msg->data[5];
+		proc->regs.t4 = _msg_cap_pack(msg->capty[1], msg->cap[1]);
+		proc->regs.t5 = _msg_cap_pack(msg->capty[2], msg->cap[2]);
+		proc->regs.t6 = _msg_cap_pack(msg->capty[3], msg->cap[3]);
+	}
+	// The capabilities keep their indices.
+	for (int k = 0; k < IPC_MSG_CAPS; ++k) {
+		_capability_transfer(owner, msg->capty[k], msg->cap[k], receiver);
+	}
+}
+
 /**
  * Check if the IPC invocation has valid access.
  */
@@ -253,16 +811,102 @@ static bool _ipc_invoke_valid_access(pid_t owner, index_t i, ipc_mode_t mode, bo
 	return sink ? (ipc_table[i].sink == i) : (ipc_table[i].sink != i);
 }
 
+/**
+ * Acquires the receiver of a sink if it waits on the sink, or on another member of the sink's endpoint set,
+ * and takes the capabilities of a synchronous message.
+ * A set wait returns the index of the sink in a5, the sender fills in the rest of the message.
+ */
+static bool _receiver_acquire(pid_t receiver, index_t sink, const ipc_msg_t *msg)
+{
+	index_t w;
+	if (!proc_ipc_waiting(receiver, &w) || w >= ARRAY_SIZE(ipc_table)) {
+		return false;
+	}
+	if (w != sink && !(ipc_sets[w].waiting && _set_contains(w, sink))) {
+		return false;
+	}
+	if ((msg && !_msg_fits(receiver, msg)) || !proc_ipc_acquire(receiver, w)) {
+		return false;
+	}
+	// The receive ends, its copy destination with it.
+	ipc_copies[w] = (ipc_copy_t){0};
+	if (ipc_sets[w].waiting) {
+		proc_t *proc = proc_get(receiver);
+		proc->regs.a2 = 0;
+		proc->regs.a3 = CAPTY_NONE;
+		proc->regs.a4 = 0;
+		proc->regs.a5 = sink;
+	}
+	return true;
+}
+
+/**
+ * Checks if a caller's timeout leaves the receiver of a yielding channel its service time.
+ */
+static bool _call_in_time(index_t sink, uint32_t servtime, uint64_t timeout)
+{
+	if (!(ipc_table[sink].flag & IPC_FLAG_YIELD)) {
+		return true;
+	}
+	return rtc_get_time() + ((uint64_t)servtime) * TICKS_PER_US < timeout;
+}
+
+/**
+ * Delivers the call of the first caller waiting for sink i to its owner, as if it had just been made.
+ * Callers that gave up waiting are skipped, servtime is the owner's service time for the call.
+ */
+static bool _callers_serve(pid_t owner, index_t i, uint32_t servtime)
+{
+	index_t source;
+	while (_callers_pop(i, &source)) {
+		// Hold the caller while its registers are read, it gave up if it is no longer blocked on the source.
+		pid_t caller = *_owner(source);
+		if (caller == INVALID_PID || !proc_ipc_acquire(caller, source)) {
+			continue;
+		}
+		// The call is still in the caller's registers.
+		proc_t *proc = proc_get(caller);
+		ipc_msg_t msg;
+		ipc_msg_get(proc, &msg);
+		int err = ERR_SUCCESS;
+		if (revoke_stale(&ipc_revoked, source) || !_msg_fits(owner, &msg)) {
+			err = ERR_INVALID_STATE;
+		} else if (!_valid_msg_send(caller, &msg, ipc_table[source].flag)) {
+			// A capability was lost while waiting.
+			err = ERR_INVALID_ARGUMENT;
+		} else if (!_call_in_time(i, servtime, ipc_callers[source].timeout)) {
+			// The caller's time ran out while waiting, as for a call made now.
+			err = ERR_TIMEOUT;
+		}
+		if (err != ERR_SUCCESS) {
+			proc->regs.a0 = err;
+			proc->timeout = 0;
+			proc_release(caller);
+			continue;
+		}
+		do_send(owner, &msg, caller);
+		ipc_table[i].source = source;
+		ipc_table[i].opt = 0;
+		ipc_callers[source].reply = true;
+		proc_get(owner)->regs.a6 = source;
+		// The caller waits for the reply.
+		proc_ipc_block(caller, source);
+		proc_release(caller);
+		return true;
+	}
+	return false;
+}
+
 /**
  * Send data and potentially a capability to the receiver.
  * For synchronous unidirectional IPC only!
  */
-int ipc_send(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next)
+int ipc_send(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next)
 {
 	if (UNLIKELY(!_ipc_invoke_valid_access(owner, i, IPC_MODE_USYNC, false))) {
 		return ERR_INVALID_ACCESS;
 	}
-	if (UNLIKELY(!_valid_capability_send(owner, j, capty, ipc_table[i].flag))) {
+	if (UNLIKELY(!_valid_msg_send(owner, msg, ipc_table[i].flag))) {
 		return ERR_INVALID_ARGUMENT;
 	}
 
@@ -270,7 +914,7 @@ int ipc_send(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, p
 	index_t sink = ipc_table[i].sink;
 
 	// Get the receiver process.
-	pid_t receiver = ipc_table[sink].owner;
+	pid_t receiver = *_owner(sink);
 	if (receiver == INVALID_PID) {
 		return ERR_INVALID_STATE;
 	}
@@ -289,12 +933,12 @@ int ipc_send(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, p
 	}
 
 	// Check if the receiver is ready.
-	if (!proc_ipc_acquire(receiver, sink)) {
+	if (!_receiver_acquire(receiver, sink, msg)) {
 		return ERR_INVALID_STATE;
 	}
 
 	// Send the data to the target process.
-	do_send(receiver, data, owner, capty, j);
+	do_send(receiver, msg, owner);
 	ipc_table[sink].source = i;
 
 	proc_t *sender = *next;
@@ -314,111 +958,250 @@ int ipc_send(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, p
  * Receive data and potentially a capability from the sender.
  * For synchronous IPC only!
  */
-int ipc_recv(pid_t owner, index_t i, proc_t **next, uint32_t servtime)
+int ipc_recv(pid_t owner, index_t i, proc_t **next, uint32_t servtime, index_t mem, word_t base, word_t size)
 {
 	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_USYNC, true)
-	    && _ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, true)) {
+	    && !_ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, true)) {
 		return ERR_INVALID_ACCESS;
 	}
+	if (size > 0 && !mem_valid_range(owner, mem, base, size, MEM_PERM_RW)) {
+		return ERR_INVALID_ARGUMENT;
+	}
+	// A waiting caller is received without blocking.
+	if (_callers_serve(owner, i, servtime)) {
+		return ERR_SUCCESS;
+	}
 	// Go to a receiver state.
 	proc_ipc_block(owner, i);
+	ipc_sets[i].waiting = false;
 	ipc_table[i].source = i;
 	ipc_table[i].opt = servtime;
+	ipc_copies[i] = (ipc_copy_t){.base = base, .size = size, .mem = mem};
 
 	(*next)->timeout = UINT64_MAX;
 	*next = NULL;
 	return ERR_SUCCESS;
 }
 
+/**
+ * Delivers a call on source i to the acquired receiver of its sink, the caller waits for the reply.
+ */
+static int _call_deliver(pid_t owner, index_t i, index_t sink, pid_t receiver, const ipc_msg_t *msg,
+			 proc_t **next)
+{
+	// A caller that was suspended while queued keeps its entry, it must not be served again.
+	_callers_remove(i);
+
+	// Perform the send operation.
+	do_send(receiver, msg, owner);
+
+	// Set the receiver's source capability, and give it a reply capability for the call.
+	ipc_table[sink].source = i;
+	ipc_table[sink].opt = 0;
+	ipc_callers[i].reply = true;
+	proc_get(receiver)->regs.a6 = i;
+
+	// Wait for reply.
+	proc_ipc_block(owner, i);
+
+	proc_t *sender = *next;
+	if (ipc_table[i].flag & IPC_FLAG_YIELD) {
+		// If yielding IPC, set the next process to the receiver.
+		*next = proc_get(receiver);
+		// Receiver inherits the sender's timeout.
+		(*next)->timeout = sender->timeout;
+	} else {
+		// Release the receiver.
+		proc_release(receiver);
+		sender->timeout = UINT64_MAX;
+	}
+	return ERR_TIMEOUT;
+}
+
 /**
  * Send a synchronous IPC call to the receiver.
  */
-int ipc_call(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next)
+int ipc_call(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next)
 {
 	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, false)) {
 		return ERR_INVALID_ACCESS;
 	}
-	if (!_valid_capability_send(owner, j, capty, ipc_table[i].flag)) {
+	if (!_valid_msg_send(owner, msg, ipc_table[i].flag)) {
 		return ERR_INVALID_ARGUMENT;
 	}
 	// Get the sink capability and receiver process.
 	index_t sink = ipc_table[i].sink;
-	pid_t receiver = ipc_table[sink].owner;
+	pid_t receiver = *_owner(sink);
 
 	if (receiver == INVALID_PID) {
 		return ERR_INVALID_STATE;
 	}
 
-	uint32_t servtime = ipc_table[sink].opt;
-	bool is_yield = (ipc_table[sink].flag & IPC_FLAG_YIELD) != 0;
+	// If the service time exceeds the current timeout, return invalid state error.
+	if (!_call_in_time(sink, ipc_table[sink].opt, current->timeout)) {
+		return ERR_INVALID_STATE;
+	}
 
-	if (is_yield) {
-		// Update the timeout for the call.
-		uint64_t curr_time = rtc_get_time();
-		uint64_t timeout = current->timeout;
-		if (curr_time + ((uint64_t)servtime) * TICKS_PER_US >= timeout) {
-			// If the service time exceeds the current timeout, return timeout error.
+	// If receiver is not ready, wait for it in the caller queue or return invalid state error.
+	if (!_receiver_acquire(receiver, sink, msg)) {
+		if (!(ipc_table[sink].flag & IPC_FLAG_QUEUE)) {
 			return ERR_INVALID_STATE;
 		}
+		// The call stays in the registers until the receiver takes it, see _callers_serve.
+		// A caller that was suspended while waiting goes to the back of the queue.
+		_callers_remove(i);
+		_callers_push(sink, i);
+		ipc_callers[i].timeout = current->timeout;
+		proc_ipc_block(owner, i);
+		(*next)->timeout = UINT64_MAX;
+		*next = NULL;
+		return ERR_TIMEOUT;
 	}
 
-	// If receiver is invalid or not ready, return invalid state error.
-	if (!proc_ipc_acquire(receiver, sink)) {
-		return ERR_INVALID_STATE;
+	return _call_deliver(owner, i, sink, receiver, msg, next);
+}
+
+/**
+ * Copies a chunk of a bulk copy, eight words per iteration if both ends are word aligned.
+ */
+static void _copy_chunk(uint8_t *dst, const uint8_t *src, word_t n)
+{
+	if ((((word_t)dst | (word_t)src) % sizeof(word_t)) == 0) {
+		word_t *d = (word_t *)dst;
+		const word_t *s = (const word_t *)src;
+		// Loads are issued before stores, so they overlap in the pipeline.
+		for (; n >= 8 * sizeof(word_t); n -= 8 * sizeof(word_t)) {
+			word_t w0 = s[0], w1 = s[1], w2 = s[2], w3 = s[3];
+			word_t w4 = s[4], w5 = s[5], w6 = s[6], w7 = s[7];
+			d[0] = w0;
+			d[1] = w1;
+			d[2] = w2;
+			d[3] = w3;
+			d[4] = w4;
+			d[5] = w5;
+			d[6] = w6;
+			d[7] = w7;
+			d += 8;
+			s += 8;
+		}
+		for (; n >= sizeof(word_t); n -= sizeof(word_t)) {
+			*d++ = *s++;
+		}
+		dst = (uint8_t *)d;
+		src = (const uint8_t *)s;
+	}
+	while (n-- > 0) {
+		*dst++ = *src++;
 	}
+}
 
-	// Perform the send operation.
-	do_send(receiver, data, owner, capty, j);
+/**
+ * Copy memory to the destination registered by the receiver, then call it with the size copied.
+ */
+int ipc_copy(pid_t owner, index_t i, index_t mem, word_t base, word_t size, word_t tag, word_t *done,
+	     proc_t **next)
+{
+	*done = 0;
+	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, false)) {
+		return ERR_INVALID_ACCESS;
+	}
+	if (!mem_valid_range(owner, mem, base, size, MEM_PERM_R)) {
+		return ERR_INVALID_ARGUMENT;
+	}
 
-	// Set the receiver's source capability.
-	ipc_table[sink].source = i;
-	ipc_table[sink].opt = 0;
+	// The receiver must wait in ipc_recv on the sink, its destination is checked again as it may have been revoked.
+	index_t sink = ipc_table[i].sink;
+	pid_t receiver = *_owner(sink);
+	ipc_copy_t *copy = &ipc_copies[sink];
+	index_t w;
+	if (receiver == INVALID_PID || !proc_ipc_waiting(receiver, &w) || w != sink || copy->size == 0
+	    || !mem_valid_range(receiver, copy->mem, copy->base, copy->size, MEM_PERM_RW)) {
+		return ERR_INVALID_STATE;
+	}
+	if (!_call_in_time(sink, ipc_table[sink].opt, current->timeout)) {
+		return ERR_INVALID_STATE;
+	}
+	// The destination is bound to the first copy until it is delivered, or its source is deleted,
+	// revoked or transferred, so copies from different sources can not restart each other.
+	if (copy->source != i + 1) {
+		index_t holder = copy->source - 1;
+		if (copy->source != 0 && !revoke_stale(&ipc_revoked, holder)) {
+			return ERR_INVALID_STATE;
+		}
+		copy->source = i + 1;
+		copy->done = 0;
+	}
 
-	// Wait for reply.
-	proc_ipc_block(owner, i);
+	// Copy in chunks, the progress is kept so a preempted copy resumes where it stopped.
+	word_t n = (size < copy->size) ? size : copy->size;
+	while (copy->done < n) {
+		word_t len = (n - copy->done < IPC_COPY_CHUNK) ? n - copy->done : IPC_COPY_CHUNK;
+		_copy_chunk((uint8_t *)(copy->base + copy->done), (const uint8_t *)(base + copy->done), len);
+		copy->done += len;
+		if (copy->done < n && preempt()) {
+			*done = copy->done;
+			return ERR_PREEMPTED;
+		}
+	}
+	*done = n;
 
-	proc_t *sender = *next;
-	if (ipc_table[i].flag & IPC_FLAG_YIELD) {
-		// If yielding IPC, set the next process to the receiver.
-		*next = proc_get(receiver);
-		// Receiver inherits the sender's timeout.
-		(*next)->timeout = sender->timeout;
-	} else {
-		// Release the receiver.
-		proc_release(receiver);
-		sender->timeout = UINT64_MAX;
+	// Deliver the copy as a call, the destination is dropped when the receiver is acquired.
+	ipc_msg_t msg = {.data = {n, tag}};
+	if (!_receiver_acquire(receiver, sink, &msg)) {
+		return ERR_INVALID_STATE;
 	}
-	return ERR_TIMEOUT;
+	return _call_deliver(owner, i, sink, receiver, &msg, next);
 }
 
 /**
- * Reply to a synchronous IPC call.
+ * Acquires the caller of the call in service on source i if it takes the reply, using up the reply capability.
  */
-int ipc_reply(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next)
+static bool _reply_acquire(index_t sink, index_t i, const ipc_msg_t *msg, pid_t *caller)
 {
-	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, true)) {
+	*caller = *_owner(i);
+	if (!ipc_callers[i].reply || *caller == INVALID_PID || !_msg_fits(*caller, msg)
+	    || !proc_ipc_acquire(*caller, i)) {
+		return false;
+	}
+	ipc_callers[i].reply = false;
+	if (ipc_table[sink].source == i) {
+		ipc_table[sink].source = sink; // Clear the source capability.
+	}
+	return true;
+}
+
+/**
+ * Reply to a synchronous IPC call, with a reply capability or to the most recent call on a sink.
+ */
+int ipc_reply(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next)
+{
+	index_t sink, source;
+	if (_reply_valid_access(owner, i)) {
+		sink = ipc_table[i].sink;
+		source = i;
+	} else if (_ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, true)) {
+		sink = i;
+		source = ipc_table[i].source;
+	} else {
 		return ERR_INVALID_ACCESS;
 	}
-	if (!_valid_capability_send(owner, j, capty, ipc_table[i].flag)) {
+	if (!_valid_msg_send(owner, msg, ipc_table[sink].flag)) {
 		return ERR_INVALID_ARGUMENT;
 	}
-	// Get the source capability and client process.
-	index_t source = ipc_table[i].source;
-	pid_t receiver_pid = ipc_table[source].owner;
 
 	// Check if the client is valid and ready.
-	if ((source == i) || (receiver_pid == INVALID_PID) || !proc_ipc_acquire(receiver_pid, source)) {
+	pid_t receiver_pid;
+	if (!_reply_acquire(sink, source, msg, &receiver_pid)) {
 		return ERR_INVALID_STATE;
 	}
 
 	// Send the operation.
-	do_send(receiver_pid, data, owner, capty, j);
-	ipc_table[i].source = i; // Clear the source capability.
+	do_send(receiver_pid, msg, owner);
 
 	proc_t *sender = *next;
 	proc_t *receiver = proc_get(receiver_pid);
 
-	if (ipc_table[i].flag & IPC_FLAG_YIELD) {
+	if (ipc_table[sink].flag & IPC_FLAG_YIELD) {
 		// If yielding IPC, set the next process to the receiver.
 		*next = receiver;
 		// The receiver inherits the timeout.
@@ -435,13 +1218,13 @@ int ipc_reply(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j,
 /**
  * Reply and receive in a single IPC operation.
  */
-int ipc_replyrecv(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t j, proc_t **next, uint32_t servtime)
+int ipc_replyrecv(pid_t owner, index_t i, const ipc_msg_t *msg, proc_t **next, uint32_t servtime)
 {
 	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_BSYNC, true)) {
 		return ERR_INVALID_ACCESS;
 	}
 
-	if (!_valid_capability_send(owner, j, capty, ipc_table[i].flag)) {
+	if (!_valid_msg_send(owner, msg, ipc_table[i].flag)) {
 		return ERR_INVALID_ARGUMENT;
 	}
 
@@ -450,14 +1233,11 @@ int ipc_replyrecv(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t
 	// Set next to null by default.
 	*next = NULL;
 
-	// Get the source and sink capabilities.
-	index_t source = ipc_table[i].source;
-	pid_t recv_pid = ipc_table[source].owner;
-
-	if ((source != i) && (recv_pid != INVALID_PID) && proc_ipc_acquire(recv_pid, source)) {
+	// Reply to the most recent call, the reply capabilities of earlier calls are kept.
+	pid_t recv_pid;
+	if (_reply_acquire(i, ipc_table[i].source, msg, &recv_pid)) {
 		// Do send operation.
-		do_send(recv_pid, data, owner, capty, j);
-		ipc_table[i].source = i; // Clear the source capability.
+		do_send(recv_pid, msg, owner);
 
 		proc_t *receiver = proc_get(recv_pid);
 
@@ -474,33 +1254,109 @@ int ipc_replyrecv(pid_t owner, index_t i, word_t data[2], capty_t capty, index_t
 		}
 	}
 
+	// A waiting caller is received without blocking, the server keeps running unless it yielded.
+	if (_callers_serve(owner, i, servtime)) {
+		if (*next == NULL)
+			*next = sender;
+		return ERR_SUCCESS;
+	}
+
 	// Perform receive operation.
 	proc_ipc_block(owner, i);
+	ipc_sets[i].waiting = false;
 	ipc_table[i].opt = servtime; // Store service time in opt field.
+	ipc_copies[i] = (ipc_copy_t){0};
 	sender->timeout = UINT64_MAX;
 
 	return ERR_SUCCESS;
 }
 
 /**
- * Asynchronously send data.
+ * Queues data at an asynchronous sink, returns false if the queue is full.
+ */
+static bool _enqueue(index_t sink, word_t data)
+{
+	ipc_queue_t *q = &ipc_queues[ipc_queue_of[sink]];
+
+	// The sender decides what to do with a full queue, nothing is overwritten.
+	if (q->count == MAX_IPC_QUEUE) {
+		return false;
+	}
+
+	q->msg[(q->head + q->count) % MAX_IPC_QUEUE] = data;
+	q->count++;
+	return true;
+}
+
+/**
+ * Takes the oldest queued message or the pending signals of an asynchronous sink.
+ */
+static bool _take(index_t sink, word_t *data)
+{
+	if (ipc_table[sink].mode == IPC_MODE_NOTIFY) {
+		*data = ipc_table[sink].opt;
+		ipc_table[sink].opt = 0;
+		return *data != 0;
+	}
+
+	if (ipc_table[sink].mode != IPC_MODE_ASYNC || ipc_queues[ipc_queue_of[sink]].count == 0) {
+		return false;
+	}
+	ipc_queue_t *q = &ipc_queues[ipc_queue_of[sink]];
+	*data = q->msg[q->head];
+	q->head = (q->head + 1) % MAX_IPC_QUEUE;
+	q->count--;
+	return true;
+}
+
+/**
+ * Asynchronously send data, queued at the sink until it is received.
+ * A notification source instead ORs its badge, or the data if it has none, into the sink's signal word.
  */
 int ipc_asend(pid_t owner, index_t i, word_t data, proc_t **next)
 {
-	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_ASYNC, false)) {
+	bool notify = _ipc_invoke_valid_access(owner, i, IPC_MODE_NOTIFY, false);
+	if (!notify && !_ipc_invoke_valid_access(owner, i, IPC_MODE_ASYNC, false)) {
 		return ERR_INVALID_ACCESS;
 	}
 
+	// An empty signal would wake a waiting receiver with nothing to receive.
+	uint32_t signal = ipc_table[i].opt ? ipc_table[i].opt : (uint32_t)data;
+	if (notify && signal == 0) {
+		return ERR_INVALID_ARGUMENT;
+	}
+
 	index_t sink = ipc_table[i].sink;
-	pid_t recv_pid = ipc_table[sink].owner;
+	pid_t recv_pid = *_owner(sink);
+	bool is_yield = (ipc_table[i].flag & IPC_FLAG_YIELD) != 0;
 
-	// Data stored in the opt field.
+	if (notify) {
+		// Signals accumulate until received, so signals from different sources are never lost.
+		ipc_table[sink].opt |= signal;
+	} else if (!_enqueue(sink, data)) {
+		return ERR_INVALID_STATE;
+	}
 	ipc_table[sink].source = i;
-	ipc_table[sink].opt = data;
 
-	if ((ipc_table[i].flag & IPC_FLAG_YIELD) && recv_pid != INVALID_PID && proc_acquire(recv_pid)) {
-		proc_t *sender = *next;
-		proc_t *receiver = proc_get(recv_pid);
+	if (recv_pid == INVALID_PID) {
+		return ERR_SUCCESS;
+	}
+
+	proc_t *sender = *next;
+	proc_t *receiver = proc_get(recv_pid);
+	if (_receiver_acquire(recv_pid, sink, NULL)) {
+		// The receiver waits in ipc_arecv_wait or ipc_set_wait, complete its receive.
+		_take(sink, &receiver->regs.a1);
+		receiver->regs.a0 = ERR_SUCCESS;
+		if (is_yield) {
+			*next = receiver;
+			receiver->timeout = sender->timeout;
+		} else {
+			// Set timeout to 0 so it can be scheduled as soon as possible.
+			proc_release(recv_pid);
+			receiver->timeout = 0;
+		}
+	} else if (is_yield && proc_acquire(recv_pid)) {
 		*next = receiver;
 		receiver->timeout = sender->timeout;
 	}
@@ -508,14 +1364,177 @@ int ipc_asend(pid_t owner, index_t i, word_t data, proc_t **next)
 }
 
 /**
- * Asynchronously receive data.
+ * Asynchronously receive data, the oldest queued message first.
+ * A notification sink returns and clears its pending signals.
  */
 int ipc_arecv(pid_t owner, index_t i, word_t *data)
 {
-	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_ASYNC, true)) {
+	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_NOTIFY, true)
+	    && !_ipc_invoke_valid_access(owner, i, IPC_MODE_ASYNC, true)) {
+		return ERR_INVALID_ACCESS;
+	}
+	// An empty queue is reported like a receiver that is not ready for ipc_send.
+	return _take(i, data) ? ERR_SUCCESS : ERR_INVALID_STATE;
+}
+
+/**
+ * Asynchronously receive data, waiting for the next message or signal if nothing is pending.
+ */
+int ipc_arecv_wait(pid_t owner, index_t i, word_t *data, uint64_t timeout, proc_t **next)
+{
+	int err = ipc_arecv(owner, i, data);
+	if (err != ERR_INVALID_STATE) {
+		return err;
+	}
+
+	if (timeout != 0 && timeout <= rtc_get_time()) {
+		return ERR_TIMEOUT;
+	}
+
+	// Wait for ipc_asend, or for the scheduler to expire the wait with ERR_TIMEOUT in a0.
+	proc_ipc_block(owner, i);
+	ipc_sets[i].waiting = false;
+	(*next)->timeout = (timeout != 0) ? timeout : UINT64_MAX;
+	*next = NULL;
+	return ERR_TIMEOUT;
+}
+
+/**
+ * Wakes a process whose ipc_arecv_wait or ipc_set_wait has timed out.
+ */
+bool ipc_wait_expire(pid_t pid)
+{
+	index_t i;
+	// Waits on a source and ipc_recv have no timeout, their process timeout is UINT64_MAX or their time slice.
+	if (!proc_ipc_waiting(pid, &i) || i >= ARRAY_SIZE(ipc_table) || ipc_table[i].sink != i) {
+		return false;
+	}
+	return proc_ipc_acquire(pid, i);
+}
+
+/**
+ * Checks if capability i is a sink that can be in an endpoint set.
+ */
+static bool _set_valid_access(pid_t owner, index_t i)
+{
+	return ipc_valid_access(owner, i) && ipc_table[i].mode != IPC_MODE_NONE && ipc_table[i].sink == i;
+}
+
+/**
+ * Adds sink j to the endpoint set of sink i.
+ */
+int ipc_set_join(pid_t owner, index_t i, index_t j)
+{
+	if (UNLIKELY(!_set_valid_access(owner, i) || !_set_valid_access(owner, j))) {
 		return ERR_INVALID_ACCESS;
 	}
-	// Read data from the opt field.
-	*data = ipc_table[i].opt;
+	if (UNLIKELY(ipc_sets[j].next != j || i == j)) {
+		// Already in a set.
+		return ERR_INVALID_STATE;
+	}
+	ipc_sets[j].next = ipc_sets[i].next;
+	ipc_sets[i].next = j;
 	return ERR_SUCCESS;
 }
+
+/**
+ * Removes sink i from its endpoint set.
+ */
+int ipc_set_leave(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!_set_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+	_set_unlink(i);
+	return ERR_SUCCESS;
+}
+
+/**
+ * Receive from any member of the endpoint set of sink i, waiting for the first sender if nothing is pending.
+ * The message is written to the owner's registers as by a sender, with the index of the member in a5.
+ */
+int ipc_set_wait(pid_t owner, index_t i, uint32_t servtime, uint64_t timeout, proc_t **next)
+{
+	if (UNLIKELY(!_set_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	proc_t *proc = proc_get(owner);
+
+	// Pending asynchronous messages and signals are received first, starting with sink i.
+	index_t k = i;
+	do {
+		if (_take(k, &proc->regs.a1)) {
+			proc->regs.a2 = 0;
+			proc->regs.a3 = CAPTY_NONE;
+			proc->regs.a4 = 0;
+			proc->regs.a5 = k;
+			return ERR_SUCCESS;
+		}
+		k = ipc_sets[k].next;
+	} while (k != i);
+
+	// Then waiting callers, as after ipc_recv.
+	do {
+		if (ipc_table[k].mode == IPC_MODE_BSYNC && _callers_serve(owner, k, servtime)) {
+			proc->regs.a5 = k;
+			return ERR_SUCCESS;
+		}
+		k = ipc_sets[k].next;
+	} while (k != i);
+
+	if (timeout != 0 && timeout <= rtc_get_time()) {
+		return ERR_TIMEOUT;
+	}
+
+	// Synchronous members are ready to receive, as after ipc_recv.
+	do {
+		if (ipc_table[k].mode == IPC_MODE_USYNC || ipc_table[k].mode == IPC_MODE_BSYNC) {
+			ipc_table[k].opt = servtime;
+		}
+		k = ipc_sets[k].next;
+	} while (k != i);
+
+	// Wait for the first sender on any member, or for the scheduler to expire the wait.
+	proc_ipc_block(owner, i);
+	ipc_sets[i].waiting = true;
+	ipc_copies[i] = (ipc_copy_t){0};
+	(*next)->timeout = (timeout != 0) ? timeout : UINT64_MAX;
+	*next = NULL;
+	return ERR_TIMEOUT;
+}
+
+/**
+ * Asynchronously receive up to count queued messages.
+ */
+int ipc_adrain(pid_t owner, index_t i, word_t *buf, word_t count)
+{
+	if (!_ipc_invoke_valid_access(owner, i, IPC_MODE_ASYNC, true)) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	ipc_queue_t *q = &ipc_queues[ipc_queue_of[i]];
+	word_t n = 0;
+	while (n < count && q->count > 0) {
+		buf[n++] = q->msg[q->head];
+		q->head = (q->head + 1) % MAX_IPC_QUEUE;
+		q->count--;
+	}
+	return n;
+}
+
+/**
+ * Lists the IPC capabilities of a process.
+ */
+word_t ipc_list(pid_t owner, index_t *buf, word_t count, word_t offset)
+{
+	return owner_list(&ipc_owned, owner, _link, ipc_valid_access, buf, count, offset);
+}
+
+/**
+ * Sweeps pending revocations of the IPC table.
+ */
+void ipc_sweep(void)
+{
+	revoke_sweep(&ipc_revoked, _sweep);
+}
@@ -1,9 +1,19 @@
+#include "lock.h"
+
+#include "csr.h"
 #include "preempt.h"
 #include "ttas.h"
 
-#ifdef SMP
+#if defined(SMP) && !defined(MULTIKERNEL)
 static ttas_t ttas = {0};
 
+#if _LOCK_STAT
+/**
+ * Lock statistics per hart, only written by the owning hart.
+ */
+static lock_stat_t lock_stats[NUM_HARTS];
+#endif
+
 void lock_init(void)
 {
 	ttas_init(&ttas);
@@ -11,13 +21,38 @@ void lock_init(void)
 
 bool lock_acquire(bool preemptable)
 {
+#if _LOCK_STAT
+	lock_stat_t *stat = &lock_stats[csrr_mhartid()];
+	uint64_t start = csrr_mcycle();
+	bool contended = __atomic_load_n(&ttas.lock, __ATOMIC_RELAXED) != 0;
+	bool acquired = ttas_acquire(&ttas, preemptable);
+	stat->wait += csrr_mcycle() - start;
+	stat->contended += contended;
+	stat->acquired += acquired;
+	return acquired;
+#else
 	return ttas_acquire(&ttas, preemptable);
+#endif
 }
 
 void lock_release(void)
 {
 	ttas_release(&ttas);
 }
+
+int lock_stat_get(word_t hart, lock_stat_t *stat)
+{
+	if (hart >= NUM_HARTS) {
+		return ERR_INVALID_ARGUMENT;
+	}
+#if _LOCK_STAT
+	*stat = lock_stats[hart];
+	return ERR_SUCCESS;
+#else
+	*stat = (lock_stat_t){0};
+	return ERR_INVALID_STATE;
+#endif
+}
 #else
 
 void lock_init(void)
@@ -32,4 +67,11 @@ bool lock_acquire(bool preemptable)
 void lock_release(void)
 {
 }
+
+int lock_stat_get(word_t hart, lock_stat_t *stat)
+{
+	*stat = (lock_stat_t){0};
+	// There is no lock to contend on with a single hart or per-hart kernels.
+	return hart < NUM_HARTS ? ERR_INVALID_STATE : ERR_INVALID_ARGUMENT;
+}
 #endif
@@ -0,0 +1,52 @@
+#include "mailbox.h"
+
+/**
+ * Lap of a position, the sequence number of a free cell at that position.
+ */
+static inline uint32_t _lap(uint32_t pos)
+{
+	return pos & ~MAILBOX_MASK;
+}
+
+bool mailbox_push(mailbox_t *mb, pid_t pid)
+{
+	uint32_t pos = __atomic_load_n(&mb->tail, __ATOMIC_RELAXED);
+	while (1) {
+		uint32_t seq = __atomic_load_n(&mb->cells[pos & MAILBOX_MASK].seq, __ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t)(seq - _lap(pos));
+		if (diff == 0) {
+			// The cell is free, claim the position.
+			if (__atomic_compare_exchange_n(&mb->tail, &pos, pos + 1, true, __ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			// The cell still holds a request from the previous lap.
+			return false;
+		} else {
+			// Another hart claimed the position.
+			pos = __atomic_load_n(&mb->tail, __ATOMIC_RELAXED);
+		}
+	}
+	mb->cells[pos & MAILBOX_MASK].pid = pid;
+	__atomic_store_n(&mb->cells[pos & MAILBOX_MASK].seq, _lap(pos) + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool mailbox_peek(mailbox_t *mb, pid_t *pid)
+{
+	uint32_t pos = mb->head;
+	uint32_t seq = __atomic_load_n(&mb->cells[pos & MAILBOX_MASK].seq, __ATOMIC_ACQUIRE);
+	if (seq != _lap(pos) + 1) {
+		// Empty, or the push to this cell has not completed.
+		return false;
+	}
+	*pid = mb->cells[pos & MAILBOX_MASK].pid;
+	return true;
+}
+
+void mailbox_pop(mailbox_t *mb)
+{
+	uint32_t pos = mb->head++;
+	// Free the cell for the next lap.
+	__atomic_store_n(&mb->cells[pos & MAILBOX_MASK].seq, _lap(pos) + MAILBOX_SIZE, __ATOMIC_RELEASE);
+}
@@ -1,15 +1,78 @@
 #include "mem.h"
 
+#include "csr.h"
 #include "macro.h"
+#include "owner.h"
 #include "pmp.h"
-#include "preempt.h"
 #include "proc.h"
+#include "revoke.h"
 
 /**
  * Table of memory capabilities.
  */
 static mem_t mem_table[MEM_TABLE_SIZE];
 
+#ifdef CAP_SOA
+/**
+ * Owners of the memory capabilities, kept apart from the table so ownership checks and sweeps
+ * stream through a dense array. The owner fields of the table entries are unused.
+ */
+static pid_t mem_owners[MEM_TABLE_SIZE];
+#endif
+
+/**
+ * The owner of the memory capability at index i.
+ */
+static inline pid_t *_owner(index_t i)
+{
+#ifdef CAP_SOA
+	return &mem_owners[i];
+#else
+	return &mem_table[i].owner;
+#endif
+}
+
+/**
+ * Ownership lists of the memory table.
+ */
+static owner_link_t mem_links[MEM_TABLE_SIZE];
+static owner_index_t mem_owned;
+
+/**
+ * Pending revocations of the memory table.
+ */
+static revoke_log_t mem_revoked;
+
+/**
+ * Bitmap of the capabilities with a PMP slot, so revocation finds them without walking the children.
+ */
+static uint64_t mem_mapped[(MEM_TABLE_SIZE + 63) / 64];
+
+/**
+ * Bitmap of the capabilities mapped on demand, they are installed in a PMP slot on an access fault.
+ */
+static uint64_t mem_demand[(MEM_TABLE_SIZE + 63) / 64];
+
+/**
+ * Software-managed PMP cache of each process, the slots holding capabilities mapped on demand.
+ * Entries are validated against the memory table when used, so unmapping does not update them.
+ */
+static struct {
+	index_t index[MAX_PMP_SLOT]; ///< Index plus one of the capability installed in each slot.
+	uint8_t referenced;	     ///< Slots installed since the clock hand last passed them.
+	uint8_t hand;		     ///< Next slot considered for replacement.
+} mem_cache[MAX_PID];
+
+_Static_assert(MAX_PMP_SLOT <= 8, "PMP cache reference bits do not fit.");
+
+/**
+ * The ownership links of a memory capability.
+ */
+static owner_link_t *_link(index_t i)
+{
+	return &mem_links[i];
+}
+
 /**
  * Initialize the memory capabilities.
  */
@@ -17,13 +80,14 @@ void mem_init(mem_t init_mems[])
 {
 	for (index_t i = 0; i < NUM_MEMORY_CAPS; ++i) {
 		mem_table[i * MAX_MEMORY_FUEL] = (mem_t){
-			.owner = 1,
 			.base = init_mems[i].base,
 			.size = init_mems[i].size,
 			.rwx = init_mems[i].rwx,
 			.cfree = MAX_MEMORY_FUEL,
 			.csize = MAX_MEMORY_FUEL,
 		};
+		*_owner(i * MAX_MEMORY_FUEL) = 1;
+		owner_set(&mem_owned, i * MAX_MEMORY_FUEL, 1, _link);
 	}
 }
 
@@ -32,7 +96,131 @@ void mem_init(mem_t init_mems[])
  */
 bool mem_valid_access(pid_t owner, index_t i)
 {
-	return (i < ARRAY_SIZE(mem_table)) && (mem_table[i].owner == owner);
+	return (i < ARRAY_SIZE(mem_table)) && (*_owner(i) == owner) && !revoke_stale(&mem_revoked, i);
+}
+
+/**
+ * Checks if a memory capability covers a range with the given permissions.
+ */
+bool mem_valid_range(pid_t owner, index_t i, word_t base, word_t size, mem_perm_t rwx)
+{
+	if (!mem_valid_access(owner, i)) {
+		return false;
+	}
+	mem_t *cap = &mem_table[i];
+	return (base + size >= base) && (cap->base <= base) && (base + size <= (word_t)cap->base + cap->size)
+	       && ((cap->rwx & rwx) == rwx);
+}
+
+/**
+ * Invalidates a stale memory capability, its PMP slot was cleared when it was revoked.
+ */
+static void _sweep(index_t i)
+{
+	*_owner(i) = INVALID_PID;
+}
+
+/**
+ * Sets the PMP slot of a memory capability.
+ */
+static void _map(index_t i, pmp_slot_t slot)
+{
+	mem_table[i].slot = slot;
+	// Atomic, a revocation on another hart may clear bits of the same word.
+	__atomic_fetch_or(&mem_mapped[i / 64], 1ull << (i % 64), __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Clears the PMP slot of a memory capability of owner.
+ */
+static void _unmap_owner(pid_t owner, index_t i)
+{
+	pmp_slot_t slot = mem_table[i].slot;
+	if (slot == 0)
+		return;
+	proc_pmp_clear(owner, slot - 1);
+	mem_table[i].slot = 0;
+	__atomic_fetch_and(&mem_mapped[i / 64], ~(1ull << (i % 64)), __ATOMIC_RELAXED);
+}
+
+/**
+ * Clears the PMP slot of a memory capability.
+ */
+static void _unmap(index_t i)
+{
+	_unmap_owner(*_owner(i), i);
+}
+
+/**
+ * Checks that a capability just mapped by owner was not revoked meanwhile by another hart, and
+ * clears its slot if it was. Either the revocation sees the slot in _unmap_range or this sees
+ * the revocation, the fences order the mapping and the revocation before the other's check.
+ */
+static bool _map_check(pid_t owner, index_t i)
+{
+#ifdef MULTIKERNEL
+	if (UNLIKELY(!mem_valid_access(owner, i))) {
+		_unmap_owner(owner, i);
+		return false;
+	}
+#else
+	(void)owner;
+	(void)i;
+#endif
+	return true;
+}
+
+/**
+ * Marks or unmarks a memory capability as mapped on demand.
+ */
+static void _set_demand(index_t i, bool demand)
+{
+	// Atomic, harts set the bits of their own capabilities in shared words.
+	if (demand)
+		__atomic_fetch_or(&mem_demand[i / 64], 1ull << (i % 64), __ATOMIC_RELAXED);
+	else
+		__atomic_fetch_and(&mem_demand[i / 64], ~(1ull << (i % 64)), __ATOMIC_RELAXED);
+}
+
+static bool _is_demand(index_t i)
+{
+	return mem_demand[i / 64] & (1ull << (i % 64));
+}
+
+/**
+ * Clears the PMP slots of the capabilities in [begin, end).
+ * The entries are no longer loaded on any hart when it returns.
+ */
+static void _unmap_range(index_t begin, index_t end)
+{
+	word_t harts = 0;
+
+	// Pairs with the mapping in _map, see _map_check.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (index_t w = begin / 64; w * 64 < end; ++w) {
+		uint64_t bits = __atomic_load_n(&mem_mapped[w], __ATOMIC_ACQUIRE);
+		if (w == begin / 64)
+			bits &= ~0ull << (begin % 64);
+		if ((w + 1) * 64 > end)
+			bits &= ~(~0ull << (end % 64));
+		while (bits) {
+			index_t i = w * 64 + __builtin_ctzll(bits);
+#ifdef MULTIKERNEL
+			harts |= 1ul << proc_hart(*_owner(i));
+#endif
+			_unmap(i);
+			bits &= bits - 1;
+		}
+	}
+
+#ifdef MULTIKERNEL
+	// The owners may be running on other harts with the entries loaded.
+	harts &= ~(1ul << csrr_mhartid());
+	if (harts)
+		proc_pmp_shootdown(harts);
+#else
+	(void)harts;
+#endif
 }
 
 /**
@@ -53,16 +241,32 @@ static bool _derivable(mem_t parent, fuel_t csize, word_t rwx, word_t base, word
 	       && _valid_rwx(rwx);
 }
 
+/**
+ * The PMP mode requested by the mode bits of rwx, zero selects NAPOT.
+ */
+static pmp_cfg_t _pmp_mode(word_t rwx)
+{
+	word_t mode = rwx & PMP_MODE_NAPOT;
+	return (mode == PMP_MODE_OFF) ? PMP_MODE_NAPOT : mode;
+}
+
 /**
  * Check if the PMP arguments are valid.
+ * A TOR region [addr << 2, top << 2) uses slot - 1 for its bottom address, so that slot must exist.
  */
-static bool _valid_pmp_args(mem_t cap, word_t slot, word_t rwx, word_t addr)
+static bool _valid_pmp_args(mem_t cap, word_t slot, word_t rwx, word_t addr, word_t top)
 {
-	word_t base = pmp_napot_decode_base(addr);
-	word_t size = pmp_napot_decode_size(addr);
+	pmp_cfg_t mode = _pmp_mode(rwx);
+	word_t base;
+	word_t size = (mode == PMP_MODE_TOR) ? pmp_decode(mode, addr, top, &base) : pmp_decode(mode, 0, addr, &base);
+	rwx &= ~(word_t)PMP_MODE_NAPOT;
 
-	return (slot > 0) && (slot <= MAX_PMP_SLOT) && (cap.base <= base) && (base + size <= cap.base + cap.size)
-	       && ((rwx & cap.rwx) == rwx) && _valid_rwx(rwx);
+	if (mode == PMP_MODE_TOR && slot < 2) {
+		return false;
+	}
+
+	return (slot > 0) && (slot <= MAX_PMP_SLOT) && (size > 0) && (cap.base <= base)
+	       && (base + size <= cap.base + cap.size) && ((rwx & cap.rwx) == rwx) && _valid_rwx(rwx);
 }
 
 /**
@@ -76,12 +280,12 @@ int mem_transfer(pid_t owner, index_t i, pid_t new_owner)
 
 	// If PMP config is set, clear it.
 	if (mem_table[i].slot != 0) {
-		proc_pmp_clear(owner, mem_table[i].slot - 1);
-		mem_table[i].slot = 0; // Clear the PMP slot.
+		_unmap(i);
 	}
 
 	// Set the new owner.
-	mem_table[i].owner = new_owner;
+	*_owner(i) = new_owner;
+	owner_set(&mem_owned, i, new_owner, _link);
 
 	return ERR_SUCCESS;
 }
@@ -97,6 +301,10 @@ int mem_introspect(pid_t owner, index_t i, fuel_t offset, mem_t *cap)
 	}
 
 	*cap = mem_table[i + offset];
+	cap->owner = *_owner(i + offset);
+	if (revoke_stale(&mem_revoked, i + offset)) {
+		cap->owner = INVALID_PID;
+	}
 	return ERR_SUCCESS;
 }
 
@@ -120,9 +328,11 @@ int mem_derive(pid_t owner, index_t i, pid_t target, fuel_t cfree, mem_perm_t rw
 	// Calculate the index of the new memory capability.
 	word_t j = i + mem_table[i].cfree;
 
+	// Invalidate a revoked capability at the new index, the rest of the range stays stale.
+	revoke_claim(&mem_revoked, j, _sweep);
+
 	// Create the new memory capability.
 	mem_table[j] = (mem_t){
-		.owner = target,
 		.cfree = cfree,
 		.csize = cfree,
 		.slot = 0,
@@ -130,6 +340,9 @@ int mem_derive(pid_t owner, index_t i, pid_t target, fuel_t cfree, mem_perm_t rw
 		.base = base,
 		.size = size,
 	};
+	*_owner(j) = target;
+	_set_demand(j, false);
+	owner_set(&mem_owned, j, target, _link);
 
 	// Return the index of the new memory capability.
 	return j;
@@ -144,27 +357,108 @@ int mem_revoke(pid_t owner, index_t i)
 		return ERR_INVALID_ACCESS;
 	}
 
-	// Revoke the child capabilities.
+	if (mem_table[i].cfree == mem_table[i].csize) {
+		return 0;
+	}
+
+	// Record the children as revoked, returns false if preempted while the log was full.
+	index_t begin = i + mem_table[i].cfree;
+	index_t end = i + mem_table[i].csize;
+	if (UNLIKELY(!revoke_push(&mem_revoked, begin, end, _sweep))) {
+		return mem_table[i].csize - mem_table[i].cfree;
+	}
+
+	// The children lose their memory before revoke returns.
+	_unmap_range(begin, end);
+
+	// Reclaim the children's capability table.
+	mem_table[i].cfree = mem_table[i].csize;
+
+	return 0;
+}
+
+/**
+ * Check if the capabilities in [begin, end) are deleted or revoked.
+ */
+static bool _dead(index_t begin, index_t end)
+{
+	for (index_t k = begin; k < end; ++k) {
+		if (*_owner(k) != INVALID_PID && !revoke_stale(&mem_revoked, k))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Check if j is a child of i, the children are laid out back to back from the allocation frontier.
+ */
+static bool _is_child(index_t i, index_t j)
+{
+	for (index_t k = i + mem_table[i].cfree; k < i + mem_table[i].csize; k += mem_table[k].csize) {
+		if (k == j)
+			return true;
+		if (mem_table[k].csize == 0)
+			return false;
+	}
+	return false;
+}
+
+/**
+ * Returns the fuel of dead children at the allocation frontier to capability i.
+ */
+static fuel_t _reclaim(index_t i)
+{
+	// Children are allocated downwards, so the most recent child is at the frontier.
+	fuel_t reclaimed = 0;
 	while (mem_table[i].cfree < mem_table[i].csize) {
-		// Get the next child capability index.
 		index_t j = i + mem_table[i].cfree;
+		fuel_t csize = mem_table[j].csize;
+		if (csize == 0 || csize > mem_table[i].csize - mem_table[i].cfree || !_dead(j, j + csize))
+			break;
+		mem_table[i].cfree += csize;
+		reclaimed += csize;
+	}
+	return reclaimed;
+}
 
-		// Clear the PMP slot if it is set.
-		if (mem_table[j].slot != 0) {
-			proc_pmp_clear(mem_table[j].owner, mem_table[j].slot - 1);
-		}
-		// Invalidate the child capability.
-		mem_table[j].owner = INVALID_PID;
+/**
+ * Returns the fuel of dead children at the allocation frontier to a memory capability.
+ */
+int mem_reclaim(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!mem_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
 
-		// Reclaim the child's capability table.
-		mem_table[i].cfree += mem_table[j].cfree;
+	return _reclaim(i);
+}
 
-		if (UNLIKELY(preempt()))
-			break;
+/**
+ * Revokes a single child of a memory capability and its subtree.
+ */
+int mem_revoke_child(pid_t owner, index_t i, index_t j)
+{
+	if (UNLIKELY(!mem_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	if (UNLIKELY(!_is_child(i, j))) {
+		return ERR_INVALID_ARGUMENT;
+	}
+
+	// Record the subtree as revoked, returns false if preempted while the log was full.
+	index_t end = j + mem_table[j].csize;
+	if (UNLIKELY(!revoke_push(&mem_revoked, j, end, _sweep))) {
+		return mem_table[j].csize;
 	}
 
-	// Return the number of unrevoked capabilities.
-	return mem_table[i].csize - mem_table[i].cfree;
+	// Only the subtree loses its memory, the siblings keep their PMP slots.
+	_unmap_range(j, end);
+
+	// Merge the fuel back if the child was at the allocation frontier.
+	_reclaim(i);
+
+	return 0;
 }
 
 /**
@@ -178,12 +472,13 @@ int mem_delete(pid_t owner, index_t i)
 
 	// Clear the PMP slot if it is set.
 	if (mem_table[i].slot != 0) {
-		proc_pmp_clear(owner, mem_table[i].slot - 1);
-		mem_table[i].slot = 0;
+		_unmap(i);
 	}
 
 	// Invalidate the capability.
-	mem_table[i].owner = INVALID_PID;
+	*_owner(i) = INVALID_PID;
+	_set_demand(i, false);
+	owner_set(&mem_owned, i, INVALID_PID, _link);
 
 	return ERR_SUCCESS;
 }
@@ -191,30 +486,45 @@ int mem_delete(pid_t owner, index_t i)
 /**
  * Enables a memory capability by setting the PMP slot.
  */
-int mem_pmp_set(pid_t owner, index_t i, pmp_slot_t slot, word_t rwx, word_t addr)
+int mem_pmp_set(pid_t owner, index_t i, pmp_slot_t slot, word_t rwx, word_t addr, word_t top)
 {
 	if (UNLIKELY(!mem_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
 	}
 
 	// Validate PMP arguments.
-	if (UNLIKELY(!_valid_pmp_args(mem_table[i], slot, rwx, addr))) {
+	if (UNLIKELY(!_valid_pmp_args(mem_table[i], slot, rwx, addr, top))) {
 		return ERR_INVALID_ARGUMENT;
 	}
 
-	// Check if the slot is already in use.
+	pmp_cfg_t mode = _pmp_mode(rwx);
+	rwx &= MEM_PERM_RWX;
+
+	// Check if the slot, and for TOR the slot holding the bottom address, is already in use.
 	if (UNLIKELY(proc_pmp_is_set(owner, slot - 1))) {
 		return ERR_SLOT_IN_USE;
 	}
+	if (UNLIKELY(mode == PMP_MODE_TOR && proc_pmp_is_set(owner, slot - 2))) {
+		return ERR_SLOT_IN_USE;
+	}
 
-	// Clear the existing PMP slot if set.
+	// Clear the existing PMP slot if set, the capability is no longer mapped on demand.
 	if (mem_table[i].slot != 0) {
-		proc_pmp_clear(owner, mem_table[i].slot - 1);
+		_unmap(i);
 	}
+	_set_demand(i, false);
 
 	// Set the new PMP slot and update the memory table.
-	proc_pmp_set(owner, slot - 1, rwx, addr);
-	mem_table[i].slot = slot;
+	if (mode == PMP_MODE_TOR) {
+		proc_pmp_set(owner, slot - 2, PMP_MODE_OFF, addr);
+		proc_pmp_set(owner, slot - 1, PMP_MODE_TOR | rwx, top);
+	} else {
+		proc_pmp_set(owner, slot - 1, mode | rwx, addr);
+	}
+	_map(i, slot);
+	if (UNLIKELY(!_map_check(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
 
 	return ERR_SUCCESS;
 }
@@ -222,12 +532,14 @@ int mem_pmp_set(pid_t owner, index_t i, pmp_slot_t slot, word_t rwx, word_t addr
 /**
  * Retrieves the PMP configuration for a memory capability.
  */
-int mem_pmp_get(pid_t owner, index_t i, pmp_slot_t *slot, mem_perm_t *rwx, pmp_addr_t *addr)
+int mem_pmp_get(pid_t owner, index_t i, pmp_slot_t *slot, word_t *rwx, pmp_addr_t *addr, pmp_addr_t *top)
 {
 	if (UNLIKELY(!mem_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
 	}
 
+	*top = 0;
+
 	// If no PMP slot is set.
 	if (mem_table[i].slot == 0) {
 		*slot = 0;
@@ -237,8 +549,16 @@ int mem_pmp_get(pid_t owner, index_t i, pmp_slot_t *slot, mem_perm_t *rwx, pmp_a
 	}
 
 	// Retrieve the PMP configuration.
+	pmp_cfg_t cfg;
 	*slot = mem_table[i].slot;
-	proc_pmp_get(owner, mem_table[i].slot - 1, rwx, addr);
+	proc_pmp_get(owner, mem_table[i].slot - 1, &cfg, addr);
+
+	// NAPOT is reported without mode bits, as it is requested.
+	*rwx = ((cfg & PMP_MODE_NAPOT) == PMP_MODE_NAPOT) ? (cfg & MEM_PERM_RWX) : cfg;
+	if ((cfg & PMP_MODE_NAPOT) == PMP_MODE_TOR) {
+		*top = *addr;
+		proc_pmp_get(owner, mem_table[i].slot - 2, &cfg, addr);
+	}
 
 	return ERR_SUCCESS;
 }
@@ -254,9 +574,216 @@ int mem_pmp_clear(pid_t owner, index_t i)
 
 	// Clear the PMP slot if it is set.
 	if (mem_table[i].slot != 0) {
-		proc_pmp_clear(owner, mem_table[i].slot - 1);
-		mem_table[i].slot = 0;
+		_unmap(i);
+	}
+	_set_demand(i, false);
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * Encodes the region of a memory capability in the fewest PMP slots.
+ * Returns the number of slots, 0 if the region can not be encoded.
+ */
+static word_t _encode(mem_t cap, pmp_cfg_t *mode, pmp_addr_t *addr, pmp_addr_t *top)
+{
+	word_t base = cap.base;
+	word_t size = cap.size;
+	*top = 0;
+	if (size == 4 && (base & 3) == 0) {
+		*mode = PMP_MODE_NA4;
+		*addr = base >> 2;
+		return 1;
+	}
+	if (size >= 8 && (size & (size - 1)) == 0 && (base & (size - 1)) == 0) {
+		*mode = PMP_MODE_NAPOT;
+		*addr = pmp_napot_encode(base, size);
+		return 1;
+	}
+	if (size > 0 && ((base | size) & 3) == 0) {
+		*mode = PMP_MODE_TOR;
+		*addr = base >> 2;
+		*top = (base + size) >> 2;
+		return 2;
+	}
+	return 0;
+}
+
+/**
+ * Marks a memory capability as mapped on demand.
+ */
+int mem_pmp_demand(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!mem_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	pmp_cfg_t mode;
+	pmp_addr_t addr, top;
+	if (UNLIKELY(mem_table[i].rwx == MEM_PERM_NONE || !_encode(mem_table[i], &mode, &addr, &top))) {
+		return ERR_INVALID_ARGUMENT;
+	}
+
+	// The slot is installed on the next access fault.
+	if (mem_table[i].slot != 0) {
+		_unmap(i);
 	}
+	_set_demand(i, true);
 
 	return ERR_SUCCESS;
 }
+
+/**
+ * Check if a PMP slot of a process holds a capability mapped on demand, which may be evicted.
+ */
+static bool _evictable(pid_t pid, pmp_slot_t s)
+{
+	index_t e = mem_cache[pid - 1].index[s];
+	if (e == 0)
+		return false;
+	mem_t *cap = &mem_table[e - 1];
+	if (*_owner(e - 1) != pid || !_is_demand(e - 1) || cap->slot == 0)
+		return false;
+	if (cap->slot - 1 == s)
+		return true;
+
+	// The slot holds the bottom address of a TOR region.
+	pmp_cfg_t cfg;
+	pmp_addr_t addr;
+	proc_pmp_get(pid, cap->slot - 1, &cfg, &addr);
+	return cap->slot - 2 == s && (cfg & PMP_MODE_NAPOT) == PMP_MODE_TOR;
+}
+
+/**
+ * Finds n adjacent slots ending at slot for a capability mapped on demand.
+ * Free slots are used first, then slots of demand-mapped capabilities are replaced with the clock
+ * algorithm. The PMP has no access bits, so a slot counts as referenced when it was installed
+ * after the hand last passed it. Returns false if every slot is pinned.
+ */
+static bool _victim(pid_t pid, word_t n, pmp_slot_t *slot)
+{
+	for (pmp_slot_t s = n - 1; s < MAX_PMP_SLOT; ++s) {
+		if (!proc_pmp_is_set(pid, s) && (n == 1 || !proc_pmp_is_set(pid, s - 1))) {
+			*slot = s;
+			return true;
+		}
+	}
+
+	uint8_t *referenced = &mem_cache[pid - 1].referenced;
+	uint8_t *hand = &mem_cache[pid - 1].hand;
+	for (word_t k = 0; k < 2 * MAX_PMP_SLOT; ++k) {
+		pmp_slot_t s = *hand;
+		*hand = (s + 1) % MAX_PMP_SLOT;
+		if ((word_t)s + 1 < n)
+			continue;
+		uint8_t bits = (n == 1) ? (1u << s) : (3u << (s - 1));
+		bool available = true;
+		for (pmp_slot_t t = s + 1 - n; t <= s; ++t) {
+			available &= !proc_pmp_is_set(pid, t) || _evictable(pid, t);
+		}
+		if (!available)
+			continue;
+		if (*referenced & bits) {
+			// Second chance.
+			*referenced &= ~bits;
+			continue;
+		}
+		*slot = s;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Evicts the capability installed in a slot, if any.
+ */
+static void _evict(pid_t pid, pmp_slot_t s)
+{
+	if (_evictable(pid, s)) {
+		_unmap(mem_cache[pid - 1].index[s] - 1);
+		proc_get(pid)->pmp_stat.evictions++;
+	}
+}
+
+typedef struct {
+	word_t addr;
+	mem_perm_t rwx;
+} _fault_t;
+
+/**
+ * Check if an unmapped capability mapped on demand covers a faulting access.
+ */
+static bool _covers(index_t i, void *ctx)
+{
+	_fault_t *f = ctx;
+	mem_t *cap = &mem_table[i];
+	return _is_demand(i) && cap->slot == 0 && cap->base <= f->addr && f->addr - cap->base < cap->size
+	       && (cap->rwx & f->rwx) == f->rwx;
+}
+
+/**
+ * Installs a capability mapped on demand covering a faulting access.
+ */
+bool mem_fault(pid_t pid, word_t addr, mem_perm_t rwx)
+{
+	// The fault was caused by a pinned slot or spans two regions, installing a slot would not help.
+	if (proc_pmp_check(pid, addr, 1, rwx)) {
+		return false;
+	}
+
+	_fault_t f = {.addr = addr, .rwx = rwx};
+	index_t i;
+	if (!owner_find(&mem_owned, pid, _link, mem_valid_access, _covers, &f, &i)) {
+		return false;
+	}
+
+	pmp_cfg_t mode;
+	pmp_addr_t base, top;
+	pmp_slot_t s;
+	word_t n = _encode(mem_table[i], &mode, &base, &top);
+	if (n == 0 || !_victim(pid, n, &s)) {
+		return false;
+	}
+
+	for (pmp_slot_t t = s + 1 - n; t <= s; ++t) {
+		_evict(pid, t);
+	}
+	if (mode == PMP_MODE_TOR) {
+		proc_pmp_set(pid, s - 1, PMP_MODE_OFF, base);
+		proc_pmp_set(pid, s, PMP_MODE_TOR | mem_table[i].rwx, top);
+		mem_cache[pid - 1].index[s - 1] = i + 1;
+		mem_cache[pid - 1].referenced |= 3u << (s - 1);
+	} else {
+		proc_pmp_set(pid, s, mode | mem_table[i].rwx, base);
+		mem_cache[pid - 1].referenced |= 1u << s;
+	}
+	mem_cache[pid - 1].index[s] = i + 1;
+	_map(i, s + 1);
+	if (UNLIKELY(!_map_check(pid, i))) {
+		return false;
+	}
+
+	// A lower pinned slot overlapping the access denies it, keep the slot and let the process handle the fault.
+	if (!proc_pmp_check(pid, addr, 1, rwx)) {
+		return false;
+	}
+
+	proc_get(pid)->pmp_stat.faults++;
+	return true;
+}
+
+/**
+ * Lists the memory capabilities of a process.
+ */
+word_t mem_list(pid_t owner, index_t *buf, word_t count, word_t offset)
+{
+	return owner_list(&mem_owned, owner, _link, mem_valid_access, buf, count, offset);
+}
+
+/**
+ * Sweeps pending revocations of the memory table.
+ */
+void mem_sweep(void)
+{
+	revoke_sweep(&mem_revoked, _sweep);
+}
@@ -1,14 +1,63 @@
 #include "mon.h"
 
 #include "macro.h"
-#include "preempt.h"
+#include "owner.h"
 #include "proc.h"
+#include "revoke.h"
+#include "ttas.h"
 #include "types.h"
 
+#define MON_NO_BLOCK ((uint16_t)-1) ///< The root has no block, it has no descendants.
+
+/**
+ * Root monitor capabilities, one per process.
+ * The root of process p has index (p - 1) * MAX_MONITOR_FUEL, the following
+ * MAX_MONITOR_FUEL - 1 indices hold its descendants.
+ */
+static mon_t mon_roots[MAX_PID];
+
+/**
+ * Block in the pool holding the descendants of each root, allocated when the
+ * root derives its first child and released when no descendant is left.
+ */
+static uint16_t mon_blocks[MAX_PID];
+
+/**
+ * Pool of blocks for the descendants of root monitor capabilities.
+ */
+static mon_t mon_pool[MON_POOL_SIZE][MAX_MONITOR_FUEL - 1];
+
+/**
+ * Stack of free blocks in the pool.
+ */
+static uint16_t mon_free[MON_POOL_SIZE];
+static uint16_t mon_nfree;
+
+/**
+ * Live descendants in each block, including stale ones that are not swept yet.
+ */
+static fuel_t mon_live[MON_POOL_SIZE];
+
 /**
- * Table of monitor capabilities.
+ * Pending revocations of descendants, roots release their whole block instead.
  */
-static mon_t mon_table[MON_TABLE_SIZE];
+static revoke_log_t mon_revoked;
+
+/**
+ * Ownership lists of the monitor capabilities, the links of descendants are stored with their block.
+ */
+static owner_link_t mon_root_links[MAX_PID];
+static owner_link_t mon_pool_links[MON_POOL_SIZE][MAX_MONITOR_FUEL - 1];
+static owner_index_t mon_owned;
+
+static owner_link_t *_link(index_t i);
+
+#ifdef MULTIKERNEL
+/**
+ * Roots on different harts share the pool.
+ */
+static ttas_t mon_pool_lock;
+#endif
 
 /**
  * Initializes the monitor capabilities for each process.
@@ -16,13 +65,106 @@ static mon_t mon_table[MON_TABLE_SIZE];
 void mon_init(void)
 {
 	for (int i = 0; i < MAX_PID; ++i) {
-		mon_table[i * MAX_MONITOR_FUEL] = (mon_t){
+		mon_roots[i] = (mon_t){
 			.owner = 1,
 			.pid = (i + 1),
 			.cfree = MAX_MONITOR_FUEL,
 			.csize = MAX_MONITOR_FUEL,
 		};
+		mon_blocks[i] = MON_NO_BLOCK;
+		owner_set(&mon_owned, i * MAX_MONITOR_FUEL, 1, _link);
+	}
+	for (int i = 0; i < MON_POOL_SIZE; ++i) {
+		mon_free[i] = i;
 	}
+	mon_nfree = MON_POOL_SIZE;
+}
+
+/**
+ * The block of the root owning index i.
+ */
+static inline uint16_t *_block(index_t i)
+{
+	return &mon_blocks[i / MAX_MONITOR_FUEL];
+}
+
+/**
+ * The capability at index i, a descendant requires that the root has a block.
+ */
+static inline mon_t *_mon(index_t i)
+{
+	fuel_t offset = i % MAX_MONITOR_FUEL;
+	if (offset == 0)
+		return &mon_roots[i / MAX_MONITOR_FUEL];
+	return &mon_pool[*_block(i)][offset - 1];
+}
+
+/**
+ * The ownership links of the capability at index i, a descendant requires that the root has a block.
+ */
+static owner_link_t *_link(index_t i)
+{
+	fuel_t offset = i % MAX_MONITOR_FUEL;
+	if (offset == 0)
+		return &mon_root_links[i / MAX_MONITOR_FUEL];
+	return &mon_pool_links[*_block(i)][offset - 1];
+}
+
+/**
+ * Allocates a block for the root at index i, unless it already has one.
+ */
+static bool _block_alloc(index_t i)
+{
+	uint16_t *block = _block(i);
+	if (*block != MON_NO_BLOCK)
+		return true;
+#ifdef MULTIKERNEL
+	ttas_acquire(&mon_pool_lock, false);
+#endif
+	if (mon_nfree > 0)
+		*block = mon_free[--mon_nfree];
+#ifdef MULTIKERNEL
+	ttas_release(&mon_pool_lock);
+#endif
+	if (*block == MON_NO_BLOCK)
+		return false;
+	// Clear capabilities left behind by the previous root.
+	for (fuel_t k = 0; k < MAX_MONITOR_FUEL - 1; ++k)
+		mon_pool[*block][k].owner = INVALID_PID;
+	mon_live[*block] = 0;
+	return true;
+}
+
+/**
+ * Returns the block of the root at index i to the pool.
+ */
+static void _block_free(index_t i)
+{
+	uint16_t *block = _block(i);
+	if (*block == MON_NO_BLOCK)
+		return;
+	// Remove the descendants from their owners' lists before the links are reused.
+	for (fuel_t k = 1; k < MAX_MONITOR_FUEL; ++k)
+		owner_set(&mon_owned, i + k, INVALID_PID, _link);
+#ifdef MULTIKERNEL
+	ttas_acquire(&mon_pool_lock, false);
+#endif
+	mon_free[mon_nfree++] = *block;
+#ifdef MULTIKERNEL
+	ttas_release(&mon_pool_lock);
+#endif
+	*block = MON_NO_BLOCK;
+}
+
+/**
+ * Invalidates the live descendant at index i, the last one returns the block of its root to the pool.
+ */
+static void _kill(index_t i)
+{
+	_mon(i)->owner = INVALID_PID;
+	// Atomic, descendants in a block may be held by processes on different harts.
+	if (__atomic_sub_fetch(&mon_live[*_block(i)], 1, __ATOMIC_RELAXED) == 0)
+		_block_free(i - i % MAX_MONITOR_FUEL);
 }
 
 /**
@@ -30,7 +172,20 @@ void mon_init(void)
  */
 bool mon_valid_access(pid_t owner, index_t i)
 {
-	return i < ARRAY_SIZE(mon_table) && mon_table[i].owner == owner;
+	if (i >= MON_TABLE_SIZE)
+		return false;
+	if (i % MAX_MONITOR_FUEL != 0 && *_block(i) == MON_NO_BLOCK)
+		return false;
+	return _mon(i)->owner == owner && !revoke_stale(&mon_revoked, i);
+}
+
+/**
+ * Invalidates a stale descendant, unless its root has released the block.
+ */
+static void _sweep(index_t i)
+{
+	if (*_block(i) != MON_NO_BLOCK && _mon(i)->owner != INVALID_PID)
+		_kill(i);
 }
 
 /**
@@ -43,7 +198,8 @@ int mon_transfer(pid_t owner, index_t i, pid_t new_owner)
 	}
 
 	// Update the owner of the capability.
-	mon_table[i].owner = new_owner;
+	_mon(i)->owner = new_owner;
+	owner_set(&mon_owned, i, new_owner, _link);
 	return ERR_SUCCESS;
 }
 
@@ -53,11 +209,20 @@ int mon_introspect(pid_t owner, index_t i, fuel_t offset, mon_t *cap)
 		return ERR_INVALID_ACCESS;
 	}
 
-	if (offset >= mon_table[i].csize) {
+	if (offset >= _mon(i)->csize) {
 		return ERR_INVALID_ARGUMENT;
 	}
 
-	*cap = mon_table[i + offset];
+	if (offset > 0 && *_block(i) == MON_NO_BLOCK) {
+		// The root has no descendants.
+		*cap = (mon_t){0};
+		return ERR_SUCCESS;
+	}
+
+	*cap = *_mon(i + offset);
+	if (revoke_stale(&mon_revoked, i + offset)) {
+		cap->owner = INVALID_PID;
+	}
 	return ERR_SUCCESS;
 }
 
@@ -69,7 +234,7 @@ pid_t mon_get_pid(pid_t owner, index_t i)
 	if (UNLIKELY(!mon_valid_access(owner, i))) {
 		return INVALID_PID;
 	}
-	return mon_table[i].pid;
+	return _mon(i)->pid;
 }
 
 /**
@@ -81,23 +246,36 @@ int mon_derive(pid_t owner, index_t i, pid_t target, fuel_t csize)
 		return ERR_INVALID_ACCESS;
 	}
 
-	if (UNLIKELY(csize <= 0 || mon_table[i].cfree < csize)) {
+	// The parent occupies its own index, so the child must be smaller than the parent's cfree.
+	if (UNLIKELY(csize <= 0 || _mon(i)->cfree <= csize)) {
 		return ERR_INVALID_ARGUMENT;
 	}
 
+	// Descendants are stored in the block of the root.
+	if (UNLIKELY(!_block_alloc(i))) {
+		return ERR_INVALID_STATE;
+	}
+
+	// Count the child before sweeping, so the sweep can not release the block.
+	__atomic_add_fetch(&mon_live[*_block(i)], 1, __ATOMIC_RELAXED);
+
 	// Update the parent capability.
-	mon_table[i].cfree -= csize;
+	_mon(i)->cfree -= csize;
 
 	// Calculate the index for the derived capability.
-	index_t j = i + mon_table[i].cfree;
+	index_t j = i + _mon(i)->cfree;
+
+	// Invalidate a revoked capability at the new index, the rest of the range stays stale.
+	revoke_claim(&mon_revoked, j, _sweep);
 
 	// Create the new child capability.
-	mon_table[j] = (mon_t){
+	*_mon(j) = (mon_t){
 		.owner = target,
 		.cfree = csize,
 		.csize = csize,
-		.pid = mon_table[i].pid,
+		.pid = _mon(i)->pid,
 	};
+	owner_set(&mon_owned, j, target, _link);
 
 	// Return the index of the new child capability.
 	return j;
@@ -112,23 +290,121 @@ int mon_revoke(pid_t owner, index_t i)
 		return ERR_INVALID_ACCESS;
 	}
 
-	while (mon_table[i].cfree < mon_table[i].csize) {
-		// Get the index of the next child capability.
-		index_t j = i + mon_table[i].cfree;
+	mon_t *cap = _mon(i);
+	if (cap->cfree == cap->csize) {
+		return 0;
+	}
+
+	if (i % MAX_MONITOR_FUEL == 0) {
+		// All descendants of a root are in its block, release it.
+		_block_free(i);
+	} else if (UNLIKELY(!revoke_push(&mon_revoked, i + cap->cfree, i + cap->csize, _sweep))) {
+		// Preempted while the log was full.
+		return cap->csize - cap->cfree;
+	}
+
+	// Reclaim the children's resources.
+	cap->cfree = cap->csize;
+
+	return 0;
+}
+
+/**
+ * Check if the descendants in [begin, end) are deleted or revoked.
+ */
+static bool _dead(index_t begin, index_t end)
+{
+	for (index_t k = begin; k < end; ++k) {
+		if (_mon(k)->owner != INVALID_PID && !revoke_stale(&mon_revoked, k))
+			return false;
+	}
+	return true;
+}
 
-		// Invalidate the child capability.
-		mon_table[j].owner = INVALID_PID;
+/**
+ * Check if j is a child of i, the children are laid out back to back from the allocation frontier.
+ */
+static bool _is_child(index_t i, index_t j)
+{
+	// A root without a block has no children.
+	if (*_block(i) == MON_NO_BLOCK)
+		return false;
+	mon_t *cap = _mon(i);
+	for (index_t k = i + cap->cfree; k < i + cap->csize; k += _mon(k)->csize) {
+		if (k == j)
+			return true;
+		if (_mon(k)->csize == 0)
+			return false;
+	}
+	return false;
+}
 
-		// Reclaim the child's resources.
-		mon_table[i].cfree += mon_table[j].cfree;
+/**
+ * Returns the fuel of dead children at the allocation frontier to capability i.
+ */
+static fuel_t _reclaim(index_t i)
+{
+	// Children are allocated downwards from the end of the capability.
+	mon_t *cap = _mon(i);
+	fuel_t reclaimed = 0;
+
+	// A root whose block was released has no live descendants.
+	if (*_block(i) == MON_NO_BLOCK) {
+		reclaimed = cap->csize - cap->cfree;
+		cap->cfree = cap->csize;
+		return reclaimed;
+	}
 
-		// Check for preemption.
-		if (UNLIKELY(preempt()))
+	while (cap->cfree < cap->csize) {
+		index_t j = i + cap->cfree;
+		fuel_t csize = _mon(j)->csize;
+		if (csize == 0 || csize > cap->csize - cap->cfree || !_dead(j, j + csize))
 			break;
+		cap->cfree += csize;
+		reclaimed += csize;
+	}
+
+	// A root without descendants releases its block.
+	if (i % MAX_MONITOR_FUEL == 0 && cap->cfree == cap->csize) {
+		_block_free(i);
+	}
+	return reclaimed;
+}
+
+/**
+ * Returns the fuel of dead children at the allocation frontier to a monitor capability.
+ */
+int mon_reclaim(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!mon_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	return _reclaim(i);
+}
+
+/**
+ * Revokes a single child of a monitor capability and its subtree.
+ */
+int mon_revoke_child(pid_t owner, index_t i, index_t j)
+{
+	if (UNLIKELY(!mon_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	if (UNLIKELY(!_is_child(i, j))) {
+		return ERR_INVALID_ARGUMENT;
+	}
+
+	// Record the subtree as revoked, returns false if preempted while the log was full.
+	if (UNLIKELY(!revoke_push(&mon_revoked, j, j + _mon(j)->csize, _sweep))) {
+		return _mon(j)->csize;
 	}
 
-	// Return the number of unrevoked capabilities.
-	return mon_table[i].csize - mon_table[i].cfree;
+	// Merge the fuel back if the child was at the allocation frontier.
+	_reclaim(i);
+
+	return 0;
 }
 
 /**
@@ -140,8 +416,12 @@ int mon_delete(pid_t owner, index_t i)
 		return ERR_INVALID_ACCESS;
 	}
 
-	// Invalidate the monitor capability.
-	mon_table[i].owner = INVALID_PID;
+	// Invalidate the monitor capability, a deleted descendant may release the block.
+	owner_set(&mon_owned, i, INVALID_PID, _link);
+	if (i % MAX_MONITOR_FUEL == 0)
+		_mon(i)->owner = INVALID_PID;
+	else
+		_kill(i);
 
 	return ERR_SUCCESS;
 }
@@ -154,7 +434,7 @@ int mon_suspend(pid_t owner, index_t i)
 	if (UNLIKELY(!mon_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
 	}
-	proc_suspend(mon_table[i].pid);
+	proc_suspend(_mon(i)->pid);
 	return ERR_SUCCESS;
 }
 
@@ -166,7 +446,7 @@ int mon_resume(pid_t owner, index_t i)
 	if (UNLIKELY(!mon_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
 	}
-	proc_resume(mon_table[i].pid);
+	proc_resume(_mon(i)->pid);
 	return ERR_SUCCESS;
 }
 
@@ -178,10 +458,10 @@ int mon_yield(pid_t owner, index_t i, proc_t **next)
 	if (UNLIKELY(!mon_valid_access(owner, i))) {
 		return ERR_INVALID_ACCESS;
 	}
-	if (UNLIKELY(!proc_acquire(mon_table[i].pid))) {
+	if (UNLIKELY(!proc_acquire(_mon(i)->pid))) {
 		return ERR_INVALID_STATE;
 	}
-	*next = proc_get(mon_table[i].pid);
+	*next = proc_get(_mon(i)->pid);
 	return ERR_SUCCESS;
 }
 
@@ -199,7 +479,7 @@ int mon_reg_get(pid_t owner, index_t i, word_t reg, word_t *value)
 		return ERR_INVALID_ARGUMENT; // Invalid register index.
 	}
 
-	proc_t *proc = proc_get(mon_table[i].pid);
+	proc_t *proc = proc_get(_mon(i)->pid);
 	word_t *reg_ptr = (word_t *)&proc->regs;
 	*value = reg_ptr[reg];
 	return ERR_SUCCESS;
@@ -218,7 +498,7 @@ int mon_reg_set(pid_t owner, index_t i, word_t reg, word_t value)
 		return ERR_INVALID_ARGUMENT; // Invalid register index.
 	}
 
-	proc_t *proc = proc_get(mon_table[i].pid);
+	proc_t *proc = proc_get(_mon(i)->pid);
 	word_t *reg_ptr = (word_t *)&proc->regs;
 	reg_ptr[reg] = value;
 	return ERR_SUCCESS;
@@ -233,7 +513,7 @@ int mon_vreg_get(pid_t owner, index_t i, vreg_t reg, word_t *value)
 		return ERR_INVALID_ACCESS;
 	}
 
-	proc_t *proc = proc_get(mon_table[i].pid);
+	proc_t *proc = proc_get(_mon(i)->pid);
 
 	switch (reg) {
 	case VREG_TPC:
@@ -254,6 +534,12 @@ int mon_vreg_get(pid_t owner, index_t i, vreg_t reg, word_t *value)
 	case VREG_ESP:
 		*value = proc->trap.esp;
 		return ERR_SUCCESS;
+	case VREG_PMP_FAULTS:
+		*value = proc->pmp_stat.faults;
+		return ERR_SUCCESS;
+	case VREG_PMP_EVICTIONS:
+		*value = proc->pmp_stat.evictions;
+		return ERR_SUCCESS;
 	default:
 		*value = 0;
 		return ERR_INVALID_ARGUMENT;
@@ -269,7 +555,7 @@ int mon_vreg_set(pid_t owner, index_t i, vreg_t reg, word_t value)
 		return ERR_INVALID_ACCESS;
 	}
 
-	proc_t *proc = proc_get(mon_table[i].pid);
+	proc_t *proc = proc_get(_mon(i)->pid);
 
 	switch (reg) {
 	case VREG_TPC:
@@ -290,7 +576,29 @@ int mon_vreg_set(pid_t owner, index_t i, vreg_t reg, word_t value)
 	case VREG_ESP:
 		proc->trap.esp = value;
 		return ERR_SUCCESS;
+	case VREG_PMP_FAULTS:
+		proc->pmp_stat.faults = value;
+		return ERR_SUCCESS;
+	case VREG_PMP_EVICTIONS:
+		proc->pmp_stat.evictions = value;
+		return ERR_SUCCESS;
 	default:
 		return ERR_INVALID_ARGUMENT;
 	}
 }
+
+/**
+ * Lists the monitor capabilities of a process.
+ */
+word_t mon_list(pid_t owner, index_t *buf, word_t count, word_t offset)
+{
+	return owner_list(&mon_owned, owner, _link, mon_valid_access, buf, count, offset);
+}
+
+/**
+ * Sweeps pending revocations of the monitor table.
+ */
+void mon_sweep(void)
+{
+	revoke_sweep(&mon_revoked, _sweep);
+}
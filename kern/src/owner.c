@@ -0,0 +1,102 @@
+#include "owner.h"
+
+static inline void _lock(owner_index_t *idx)
+{
+#ifdef MULTIKERNEL
+	ttas_acquire(&idx->lock, false);
+#else
+	(void)idx;
+#endif
+}
+
+static inline void _unlock(owner_index_t *idx)
+{
+#ifdef MULTIKERNEL
+	ttas_release(&idx->lock);
+#else
+	(void)idx;
+#endif
+}
+
+/**
+ * Removes index i from the list holding it.
+ */
+static void _remove(owner_index_t *idx, index_t i, owner_link_fn_t link)
+{
+	owner_link_t *l = link(i);
+	if (l->owner == INVALID_PID)
+		return;
+	if (l->prev)
+		link(l->prev - 1)->next = l->next;
+	else
+		idx->head[l->owner - 1] = l->next;
+	if (l->next)
+		link(l->next - 1)->prev = l->prev;
+	*l = (owner_link_t){0};
+}
+
+/**
+ * Inserts index i first in the list of owner.
+ */
+static void _insert(owner_index_t *idx, index_t i, pid_t owner, owner_link_fn_t link)
+{
+	owner_link_t *l = link(i);
+	index_t head = idx->head[owner - 1];
+	*l = (owner_link_t){.next = head, .prev = 0, .owner = owner};
+	if (head)
+		link(head - 1)->prev = i + 1;
+	idx->head[owner - 1] = i + 1;
+}
+
+void owner_set(owner_index_t *idx, index_t i, pid_t owner, owner_link_fn_t link)
+{
+	_lock(idx);
+	_remove(idx, i, link);
+	if (owner != INVALID_PID)
+		_insert(idx, i, owner, link);
+	_unlock(idx);
+}
+
+word_t owner_list(owner_index_t *idx, pid_t owner, owner_link_fn_t link, owner_valid_t valid, index_t *buf,
+		  word_t count, word_t offset)
+{
+	word_t n = 0;
+	_lock(idx);
+	index_t next = idx->head[owner - 1];
+	while (next) {
+		index_t i = next - 1;
+		next = link(i)->next;
+		if (!valid(owner, i)) {
+			// Swept or stale, it can not become valid again without being moved.
+			_remove(idx, i, link);
+			continue;
+		}
+		if (n >= offset && n - offset < count)
+			buf[n - offset] = i;
+		n++;
+	}
+	_unlock(idx);
+	return n;
+}
+
+bool owner_find(owner_index_t *idx, pid_t owner, owner_link_fn_t link, owner_valid_t valid, owner_match_t match,
+		void *ctx, index_t *i)
+{
+	bool found = false;
+	_lock(idx);
+	index_t next = idx->head[owner - 1];
+	while (next && !found) {
+		index_t j = next - 1;
+		next = link(j)->next;
+		if (!valid(owner, j)) {
+			_remove(idx, j, link);
+			continue;
+		}
+		if (match(j, ctx)) {
+			*i = j;
+			found = true;
+		}
+	}
+	_unlock(idx);
+	return found;
+}
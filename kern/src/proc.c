@@ -1,6 +1,8 @@
 #include "proc.h"
 
 #include "csr.h"
+#include "pmp.h"
+#include "rtc.h"
 #include "types.h"
 
 /**
@@ -49,10 +51,10 @@ pid_t proc_get_pid(const proc_t *p)
 /**
  * Sets a PMP slot for a process.
  */
-void proc_pmp_set(pid_t pid, pmp_slot_t slot, mem_perm_t rwx, pmp_addr_t addr)
+void proc_pmp_set(pid_t pid, pmp_slot_t slot, pmp_cfg_t cfg, pmp_addr_t addr)
 {
-	_proc(pid)->pmp.cfg[slot] = PMP_MODE_NAPOT | rwx; // Set PMP permissions.
-	_proc(pid)->pmp.addr[slot] = addr;		  // Set PMP address.
+	_proc(pid)->pmp.cfg[slot] = cfg;   // Set PMP mode and permissions.
+	_proc(pid)->pmp.addr[slot] = addr; // Set PMP address.
 }
 
 /**
@@ -60,6 +62,9 @@ void proc_pmp_set(pid_t pid, pmp_slot_t slot, mem_perm_t rwx, pmp_addr_t addr)
  */
 void proc_pmp_clear(pid_t pid, pmp_slot_t slot)
 {
+	if ((_proc(pid)->pmp.cfg[slot] & PMP_MODE_NAPOT) == PMP_MODE_TOR && slot > 0) {
+		_proc(pid)->pmp.addr[slot - 1] = 0; // Clear the bottom address.
+	}
 	_proc(pid)->pmp.cfg[slot] = 0;	// Clear PMP permissions.
 	_proc(pid)->pmp.addr[slot] = 0; // Clear PMP address.
 }
@@ -69,16 +74,54 @@ void proc_pmp_clear(pid_t pid, pmp_slot_t slot)
  */
 bool proc_pmp_is_set(pid_t pid, pmp_slot_t slot)
 {
-	return _proc(pid)->pmp.addr[slot] != 0; // Check if the PMP slot is set.
+	if (slot + 1 < MAX_PMP_SLOT && (_proc(pid)->pmp.cfg[slot + 1] & PMP_MODE_NAPOT) == PMP_MODE_TOR) {
+		return true; // Bottom of a TOR slot.
+	}
+	return _proc(pid)->pmp.cfg[slot] != 0 || _proc(pid)->pmp.addr[slot] != 0; // Check if the PMP slot is set.
 }
 
 /**
  * Retrieves the PMP configuration for a process.
  */
-void proc_pmp_get(pid_t pid, pmp_slot_t slot, mem_perm_t *rwx, pmp_addr_t *addr)
+void proc_pmp_get(pid_t pid, pmp_slot_t slot, pmp_cfg_t *cfg, pmp_addr_t *addr)
+{
+	*cfg = _proc(pid)->pmp.cfg[slot];   // Get PMP mode and permissions.
+	*addr = _proc(pid)->pmp.addr[slot]; // Get PMP address.
+}
+
+/**
+ * Checks if the PMP configuration of a process grants access to a memory range.
+ */
+bool proc_pmp_check(pid_t pid, word_t addr, word_t size, mem_perm_t rwx)
 {
-	*rwx = _proc(pid)->pmp.cfg[slot] & MEM_PERM_RWX; // Get PMP permissions.
-	*addr = _proc(pid)->pmp.addr[slot];		 // Get PMP address.
+	if (addr + size < addr) {
+		return false; // The range wraps around.
+	}
+
+	for (pmp_slot_t slot = 0; slot < MAX_PMP_SLOT; slot++) {
+		pmp_cfg_t cfg = _proc(pid)->pmp.cfg[slot];
+		pmp_addr_t bottom = (slot > 0) ? _proc(pid)->pmp.addr[slot - 1] : 0;
+		word_t base;
+		word_t len = pmp_decode(cfg, bottom, _proc(pid)->pmp.addr[slot], &base);
+		if (len == 0) {
+			continue; // Slot not in use.
+		}
+		word_t end = base + len;
+		if (addr + size <= base || end <= addr) {
+			continue; // Slot does not overlap the range.
+		}
+		return base <= addr && addr + size <= end && (cfg & rwx) == rwx;
+	}
+	return false;
+}
+
+/**
+ * Loads the PMP configuration of a process into the PMP registers.
+ */
+void proc_pmp_load(pid_t pid)
+{
+	csrw_pmpaddr(_proc(pid)->pmp.addr);
+	csrw_pmpcfg0(*(word_t *)_proc(pid)->pmp.cfg);
 }
 
 /**
@@ -101,32 +144,52 @@ word_t proc_get_register(pid_t pid, word_t regid)
 
 /**
  * Acquires a process by its PID.
+ * Acquire ordering so the caller observes the context saved by the last hart that released it.
  */
 bool proc_acquire(pid_t pid)
 {
-	proc_state_t state = _proc(pid)->state;
-	if (state != PROC_STATE_READY) {
-		return false;
-	}
-	_proc(pid)->state = PROC_STATE_ACQUIRED; // Mark the process as acquired.
-	return true;
+	word_t expected = PROC_STATE_READY;
+	word_t desired = PROC_STATE_ACQUIRED;
+	return __atomic_compare_exchange_n(&_proc(pid)->state, &expected, desired, false, __ATOMIC_ACQUIRE,
+					   __ATOMIC_RELAXED);
 }
 
 /**
  * Suspends a process by its PID.
+ * The suspended flag is set before the other states are cleared, so the process is never observed as ready.
  */
 void proc_suspend(pid_t pid)
 {
-	_proc(pid)->state &= PROC_STATE_ACQUIRED;  // Remove all other states but acquired.
-	_proc(pid)->state |= PROC_STATE_SUSPENDED; // Mark the process as suspended.
+#ifdef MULTIKERNEL
+	// A forwarded call that is not yet serviced is cancelled, the process restarts the call when resumed.
+	// A call in service keeps the forwarded flag until the servicing hart releases the process.
+	word_t state = __atomic_fetch_or(&_proc(pid)->state, PROC_STATE_SUSPENDED, __ATOMIC_RELAXED);
+	word_t keep = PROC_STATE_ACQUIRED | PROC_STATE_SUSPENDED;
+	if (state & PROC_STATE_ACQUIRED)
+		keep |= PROC_STATE_FORWARDED;
+	__atomic_fetch_and(&_proc(pid)->state, keep, __ATOMIC_RELAXED);
+#else
+	__atomic_fetch_or(&_proc(pid)->state, PROC_STATE_SUSPENDED, __ATOMIC_RELAXED);
+	__atomic_fetch_and(&_proc(pid)->state, PROC_STATE_ACQUIRED | PROC_STATE_SUSPENDED, __ATOMIC_RELAXED);
+#endif
 }
 
 /**
  * Resumes a suspended process.
+ * Release ordering so register updates made by the monitor are visible to the hart that acquires it.
  */
 void proc_resume(pid_t pid)
 {
-	_proc(pid)->state &= ~PROC_STATE_SUSPENDED; // Remove the suspended state.
+	__atomic_fetch_and(&_proc(pid)->state, ~(word_t)PROC_STATE_SUSPENDED, __ATOMIC_RELEASE);
+}
+
+/**
+ * Checks if a process is suspended and no hart runs it or services a call of it.
+ */
+bool proc_is_suspended(pid_t pid)
+{
+	word_t state = __atomic_load_n(&_proc(pid)->state, __ATOMIC_RELAXED);
+	return (state & (((word_t)1 << PROC_STATE_INDEX_SHIFT) - 1)) == PROC_STATE_SUSPENDED;
 }
 
 /**
@@ -135,35 +198,150 @@ void proc_resume(pid_t pid)
  */
 bool proc_ipc_acquire(pid_t pid, index_t i)
 {
-	word_t expected = PROC_STATE_BLOCKED | i << 4;
+	word_t expected = PROC_STATE_BLOCKED | (word_t)i << PROC_STATE_INDEX_SHIFT;
 	word_t desired = PROC_STATE_ACQUIRED;
-
-	if (_proc(pid)->state != expected) {
-		return false; // Process is not in the expected state, cannot acquire.
-	}
-	_proc(pid)->state = desired; // Mark the process as acquired.
-	return true;
+	return __atomic_compare_exchange_n(&_proc(pid)->state, &expected, desired, false, __ATOMIC_ACQUIRE,
+					   __ATOMIC_RELAXED);
 }
 
 /**
  * Blocks a process by its PID for IPC.
  * The index is used to identify the IPC capability used.
+ * The process stays acquired until it is released, usually by _trap_switch.
  */
 bool proc_ipc_block(pid_t pid, index_t i)
 {
 	word_t expected = PROC_STATE_ACQUIRED;
-	word_t desired = PROC_STATE_BLOCKED | PROC_STATE_ACQUIRED | i << 4;
-	if (_proc(pid)->state != expected) {
-		return false; // Process is not in the expected state, cannot block.
-	}
-	_proc(pid)->state = desired; // Mark the process as blocked.
-	return true;
+#ifdef MULTIKERNEL
+	// A forwarded process blocks while in service, it is released by the servicing hart.
+	expected |= __atomic_load_n(&_proc(pid)->state, __ATOMIC_RELAXED) & PROC_STATE_FORWARDED;
+#endif
+	word_t desired = expected | PROC_STATE_BLOCKED | (word_t)i << PROC_STATE_INDEX_SHIFT;
+	return __atomic_compare_exchange_n(&_proc(pid)->state, &expected, desired, false, __ATOMIC_RELAXED,
+					   __ATOMIC_RELAXED);
+}
+
+/**
+ * Checks which IPC capability a process is blocked on.
+ */
+bool proc_ipc_waiting(pid_t pid, index_t *i)
+{
+	word_t state = __atomic_load_n(&_proc(pid)->state, __ATOMIC_RELAXED);
+	word_t flags = state & (((word_t)1 << PROC_STATE_INDEX_SHIFT) - 1);
+	*i = state >> PROC_STATE_INDEX_SHIFT;
+	return flags == PROC_STATE_BLOCKED;
 }
 
 /**
  * Releases a process by its PID.
+ * Release ordering publishes the process context to the next hart that acquires it.
+ * Same operation as the amoand.d.rl in _trap_switch.
  */
 void proc_release(pid_t pid)
 {
-	_proc(pid)->state &= ~PROC_STATE_ACQUIRED; // Mark the process as ready.
+	__atomic_fetch_and(&_proc(pid)->state, ~(word_t)PROC_STATE_ACQUIRED, __ATOMIC_RELEASE);
+}
+
+#ifdef MULTIKERNEL
+/**
+ * Marks an acquired process as forwarded.
+ */
+void proc_forward(pid_t pid)
+{
+	__atomic_fetch_or(&_proc(pid)->state, PROC_STATE_FORWARDED, __ATOMIC_RELAXED);
+}
+
+/**
+ * Cancels a forwarded call.
+ */
+void proc_forward_cancel(pid_t pid)
+{
+	__atomic_fetch_and(&_proc(pid)->state, ~(word_t)PROC_STATE_FORWARDED, __ATOMIC_RELEASE);
+}
+
+/**
+ * Acquires a forwarded process once its hart has released it.
+ * Acquire ordering so the servicing hart observes the context saved by the process's hart.
+ */
+bool proc_forward_acquire(pid_t pid)
+{
+	word_t state = __atomic_load_n(&_proc(pid)->state, __ATOMIC_RELAXED);
+	while (1) {
+		word_t desired;
+		if (state == PROC_STATE_FORWARDED) {
+			desired = PROC_STATE_FORWARDED | PROC_STATE_ACQUIRED;
+		} else if (state == (PROC_STATE_FORWARDED | PROC_STATE_SUSPENDED)) {
+			// Suspended while its hart was switching it out, cancel the call.
+			desired = PROC_STATE_SUSPENDED;
+		} else {
+			return false;
+		}
+		if (__atomic_compare_exchange_n(&_proc(pid)->state, &state, desired, false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			return desired & PROC_STATE_ACQUIRED;
+	}
+}
+
+/**
+ * Releases a serviced process.
+ * Release ordering publishes the results of the call to the process's hart.
+ */
+void proc_forward_release(pid_t pid)
+{
+	__atomic_fetch_and(&_proc(pid)->state, ~(word_t)(PROC_STATE_ACQUIRED | PROC_STATE_FORWARDED), __ATOMIC_RELEASE);
+}
+
+/**
+ * Checks if a process has a forwarded call.
+ */
+bool proc_is_forwarded(pid_t pid)
+{
+	return __atomic_load_n(&_proc(pid)->state, __ATOMIC_RELAXED) & PROC_STATE_FORWARDED;
+}
+
+/**
+ * PMP shootdowns requested from each hart, and the last one it acknowledged.
+ */
+static struct {
+	uint32_t requested;
+	uint32_t acknowledged;
+} pmp_sync[NUM_HARTS];
+
+_Static_assert(NUM_HARTS <= 8 * sizeof(word_t), "Harts do not fit in a shootdown bitmap.");
+
+/**
+ * Acknowledges the PMP shootdowns requested from this hart.
+ * Acquire ordering so the PMP entries loaded afterwards are the cleared ones.
+ */
+void proc_pmp_sync(void)
+{
+	hart_t hart = csrr_mhartid();
+	uint32_t requested = __atomic_load_n(&pmp_sync[hart].requested, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&pmp_sync[hart].acknowledged, requested, __ATOMIC_RELEASE);
+}
+
+/**
+ * Shoots down PMP entries on other harts and waits for their acknowledgements.
+ */
+void proc_pmp_shootdown(word_t harts)
+{
+	uint32_t requested[NUM_HARTS];
+
+	// Release ordering publishes the cleared PMP entries.
+	for (hart_t hart = 0; hart < NUM_HARTS; ++hart) {
+		if (harts & (1ul << hart)) {
+			requested[hart] = __atomic_add_fetch(&pmp_sync[hart].requested, 1, __ATOMIC_SEQ_CST);
+			rtc_send_ipi(hart);
+		}
+	}
+
+	for (hart_t hart = 0; hart < NUM_HARTS; ++hart) {
+		if (!(harts & (1ul << hart)))
+			continue;
+		while ((int32_t)(__atomic_load_n(&pmp_sync[hart].acknowledged, __ATOMIC_ACQUIRE) - requested[hart]) < 0) {
+			// The software interrupt stays pending, it reloads this hart's PMP before the process resumes.
+			proc_pmp_sync();
+		}
+	}
 }
+#endif
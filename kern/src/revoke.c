@@ -0,0 +1,148 @@
+#include "revoke.h"
+
+#include "macro.h"
+#include "preempt.h"
+
+static inline void _lock(revoke_log_t *log)
+{
+#ifdef MULTIKERNEL
+	ttas_acquire(&log->lock, false);
+#else
+	(void)log;
+#endif
+}
+
+static inline void _unlock(revoke_log_t *log)
+{
+#ifdef MULTIKERNEL
+	ttas_release(&log->lock);
+#else
+	(void)log;
+#endif
+}
+
+/**
+ * Checks if the log has pending ranges, without locking it.
+ */
+static inline bool _pending(revoke_log_t *log)
+{
+	return __atomic_load_n(&log->count, __ATOMIC_RELAXED) != 0;
+}
+
+/**
+ * Removes range r, keeping the others oldest first.
+ */
+static void _remove(revoke_log_t *log, int r)
+{
+	for (int k = r + 1; k < log->count; ++k)
+		log->ranges[k - 1] = log->ranges[k];
+	log->count--;
+}
+
+/**
+ * Sweeps the first entry of the oldest range.
+ */
+static void _sweep_oldest(revoke_log_t *log, revoke_sweep_t sweep)
+{
+	revoke_range_t *oldest = &log->ranges[0];
+	sweep(oldest->begin++);
+	if (oldest->begin == oldest->end)
+		_remove(log, 0);
+}
+
+bool revoke_stale(revoke_log_t *log, index_t i)
+{
+	if (LIKELY(!_pending(log)))
+		return false;
+
+	bool stale = false;
+	_lock(log);
+	for (int r = 0; r < log->count && !stale; ++r)
+		stale = log->ranges[r].begin <= i && i < log->ranges[r].end;
+	_unlock(log);
+	return stale;
+}
+
+bool revoke_push(revoke_log_t *log, index_t begin, index_t end, revoke_sweep_t sweep)
+{
+	_lock(log);
+	while (log->count == REVOKE_MAX_RANGES) {
+		_sweep_oldest(log, sweep);
+		if (log->count == REVOKE_MAX_RANGES && UNLIKELY(preempt())) {
+			_unlock(log);
+			return false;
+		}
+	}
+	log->ranges[log->count++] = (revoke_range_t){.begin = begin, .end = end};
+	_unlock(log);
+	return true;
+}
+
+/**
+ * Checks if index i is inside a range and not at its ends, removing it would split the range.
+ */
+static bool _splits(revoke_log_t *log, index_t i)
+{
+	for (int r = 0; r < log->count; ++r) {
+		if (log->ranges[r].begin < i && i + 1 < log->ranges[r].end)
+			return true;
+	}
+	return false;
+}
+
+void revoke_claim(revoke_log_t *log, index_t i, revoke_sweep_t sweep)
+{
+	if (LIKELY(!_pending(log)))
+		return;
+
+	_lock(log);
+	// Make room for the upper part of a split range within the sweep budget.
+	for (int n = 0; n < REVOKE_SWEEP_BUDGET && log->count == REVOKE_MAX_RANGES && _splits(log, i); ++n)
+		_sweep_oldest(log, sweep);
+
+	bool swept = false;
+	for (int r = 0; r < log->count;) {
+		revoke_range_t *range = &log->ranges[r];
+		if (i < range->begin || range->end <= i) {
+			r++;
+			continue;
+		}
+		if (!swept) {
+			sweep(i);
+			swept = true;
+		}
+		if (range->begin == i) {
+			range->begin++;
+		} else if (i + 1 == range->end) {
+			range->end--;
+		} else if (log->count < REVOKE_MAX_RANGES) {
+			log->ranges[log->count++] = (revoke_range_t){.begin = i + 1, .end = range->end};
+			range->end = i;
+		} else if (i - range->begin < range->end - i) {
+			// The log is full, sweep the smaller part.
+			for (index_t k = range->begin; k < i; ++k)
+				sweep(k);
+			range->begin = i + 1;
+		} else {
+			for (index_t k = i + 1; k < range->end; ++k)
+				sweep(k);
+			range->end = i;
+		}
+		if (range->begin == range->end)
+			_remove(log, r);
+		else
+			r++;
+	}
+	_unlock(log);
+}
+
+void revoke_sweep(revoke_log_t *log, revoke_sweep_t sweep)
+{
+	if (LIKELY(!_pending(log)))
+		return;
+
+	_lock(log);
+	for (int n = 0; n < REVOKE_SWEEP_BUDGET && log->count > 0; ++n)
+		_sweep_oldest(log, sweep);
+	_unlock(log);
+}
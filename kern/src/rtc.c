@@ -100,3 +100,24 @@ void rtc_set_timeout(word_t hartid, uint64_t time)
 }
 
 #endif
+
+// The software interrupt pending bits are in the same CLINT as the timer, one word per hart.
+extern volatile uint32_t __msip[];
+
+/**
+ * @brief Raise the software interrupt of a specific hart.
+ * @param hartid ID of the hardware thread.
+ */
+void rtc_send_ipi(word_t hartid)
+{
+	__msip[hartid] = 1;
+}
+
+/**
+ * @brief Clear the software interrupt of a specific hart.
+ * @param hartid ID of the hardware thread.
+ */
+void rtc_clear_ipi(word_t hartid)
+{
+	__msip[hartid] = 0;
+}
@@ -1,8 +1,10 @@
 #include "sched.h"
 
 #include "csr.h"
+#include "ipc.h"
 #include "lock.h"
 #include "rtc.h"
+#include "syscall.h"
 
 extern void temporal_fence(void);
 
@@ -128,18 +130,25 @@ static proc_t *sched_next(hart_t hart, uint64_t *timeout)
 		return NULL; // No process scheduled for this slot
 	}
 
+#ifdef MULTIKERNEL
+	if (proc_hart(slot.pid) != hart) {
+		return NULL; // Processes only run on their own hart
+	}
+#endif
+
 	// We now have a process we may schedule.
 	proc_t *proc = proc_get(slot.pid);
 	if (proc->timeout > slot2time(rtc_slot)) {
 		return NULL; // Process is sleeping or waiting
 	}
 
-	// Try to acquire the process
-	lock_acquire(false);
-	bool proc_acquired = proc_acquire(slot.pid);
+	// Try to acquire the process, atomic so the lock is not needed.
+	// A process waiting on a sink with a timeout is acquired once the timeout has passed.
+	if (!proc_acquire(slot.pid) && !ipc_wait_expire(slot.pid)) {
+		return NULL;
+	}
 	proc->timeout = *timeout;
-	lock_release();
-	return proc_acquired ? proc : NULL;
+	return proc;
 }
 
 /**
@@ -152,6 +161,14 @@ proc_t *sched(void)
 	uint64_t timeout;
 
 	while (1) {
+#ifdef MULTIKERNEL
+		// Service forwarded calls, they may also make a process of this hart ready.
+		// The software interrupt is cleared first, so a call forwarded after the drain wakes the hart.
+		// PMP shootdowns are acknowledged, the next process loads its PMP entries when it resumes.
+		rtc_clear_ipi(hart);
+		proc_pmp_sync();
+		bool pending = syscall_drain();
+#endif
 		proc_t *next = sched_next(hart, &timeout);
 		rtc_set_timeout(hart, timeout);
 
@@ -159,9 +176,19 @@ proc_t *sched(void)
 			return next; // Return the next ready process
 		}
 
+#ifdef MULTIKERNEL
+		// Wait for the timer or a software interrupt. A request whose process is not yet
+		// switched out by its hart is retried without waiting.
+		if (!pending) {
+			while (!(csrr_mip() & (CSR_MIP_MTIP | CSR_MIP_MSIP))) {
+				__asm__ volatile("wfi");
+			}
+		}
+#else
 		// Wait for interrupt if no process is ready
 		while (!(csrr_mip() & 128)) {
 			__asm__ volatile("wfi");
 		}
+#endif
 	}
 }
@@ -0,0 +1,185 @@
+#include "spawn.h"
+
+#include "csr.h"
+#include "ipc.h"
+#include "macro.h"
+#include "mem.h"
+#include "mon.h"
+#include "proc.h"
+#include "tsl.h"
+
+/**
+ * Capabilities created or granted by a spawn, recorded in the kernel so rollback does not
+ * depend on the descriptor, which the caller's memory may change.
+ */
+typedef struct {
+	word_t nmem, nipc, nreg;
+	index_t parent[SPAWN_MAX_MEM];
+	index_t child[SPAWN_MAX_MEM];
+	index_t ipc[SPAWN_MAX_IPC];
+	word_t reg[SPAWN_MAX_REG][2]; ///< Register numbers and their previous values.
+	bool tsl;		      ///< If the time slice was derived.
+	index_t tsl_parent, tsl_child;
+} _undo_t;
+
+/**
+ * Undoes a partial spawn in reverse order.
+ * Each deleted child is then at its parent's allocation frontier, so reclaiming returns all of its fuel.
+ */
+static void _rollback(pid_t owner, index_t i, pid_t target, _undo_t *undo)
+{
+	if (undo->tsl) {
+		// Revokes the child on every member of a gang, repeated if preempted while the revocation log is full.
+		while (tsl_revoke_child(owner, undo->tsl_parent, undo->tsl_child) > 0)
+			;
+	}
+	while (undo->nreg > 0) {
+		undo->nreg--;
+		mon_reg_set(owner, i, undo->reg[undo->nreg][0], undo->reg[undo->nreg][1]);
+	}
+	while (undo->nipc > 0) {
+		undo->nipc--;
+		ipc_transfer(target, undo->ipc[undo->nipc], owner);
+	}
+	while (undo->nmem > 0) {
+		undo->nmem--;
+		mem_delete(target, undo->child[undo->nmem]);
+		mem_reclaim(owner, undo->parent[undo->nmem]);
+	}
+}
+
+/**
+ * Derives and maps the memory regions of a spawn.
+ */
+static int _spawn_mem(pid_t owner, pid_t target, spawn_t *desc, word_t nmem, _undo_t *undo)
+{
+	for (word_t k = 0; k < nmem; ++k) {
+		spawn_mem_t mem = desc->mem[k];
+		int j = mem_derive(owner, mem.parent, target, mem.csize, mem.rwx, mem.base, mem.size);
+		if (j < 0)
+			return j;
+		undo->parent[undo->nmem] = mem.parent;
+		undo->child[undo->nmem] = j;
+		undo->nmem++;
+		if (mem.slot != 0) {
+			int err = mem_pmp_set(target, j, mem.slot, mem.mode, mem.addr, mem.top);
+			if (err < 0)
+				return err;
+		}
+	}
+	return ERR_SUCCESS;
+}
+
+/**
+ * Grants the IPC capabilities of a spawn.
+ */
+static int _spawn_ipc(pid_t owner, pid_t target, spawn_t *desc, word_t nipc, _undo_t *undo)
+{
+	for (word_t k = 0; k < nipc; ++k) {
+		index_t j = desc->ipc[k];
+		int err = ipc_transfer(owner, j, target);
+		if (err < 0)
+			return err;
+		undo->ipc[undo->nipc++] = j;
+	}
+	return ERR_SUCCESS;
+}
+
+/**
+ * Sets the registers of a spawn, recording the previous values.
+ */
+static int _spawn_reg(pid_t owner, index_t i, word_t regs[][2], word_t nreg, _undo_t *undo)
+{
+	for (word_t k = 0; k < nreg; ++k) {
+		word_t old;
+		int err = mon_reg_get(owner, i, regs[k][0], &old);
+		if (err == ERR_SUCCESS)
+			err = mon_reg_set(owner, i, regs[k][0], regs[k][1]);
+		if (err < 0)
+			return err;
+		undo->reg[undo->nreg][0] = regs[k][0];
+		undo->reg[undo->nreg][1] = old;
+		undo->nreg++;
+	}
+	return ERR_SUCCESS;
+}
+
+/**
+ * Builds a process from a descriptor.
+ */
+int spawn(pid_t owner, index_t i, spawn_t *desc)
+{
+	pid_t target = mon_get_pid(owner, i);
+	if (UNLIKELY(target == INVALID_PID)) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	word_t nmem = desc->nmem;
+	word_t nipc = desc->nipc;
+	word_t nreg = desc->nreg;
+	if (UNLIKELY(nmem > SPAWN_MAX_MEM || nipc > SPAWN_MAX_IPC || nreg > SPAWN_MAX_REG)) {
+		return ERR_INVALID_ARGUMENT;
+	}
+
+	// The process must be suspended, a running process would overwrite its registers when it traps.
+	if (UNLIKELY(!proc_is_suspended(target))) {
+		return ERR_INVALID_STATE;
+	}
+
+	// Check the registers before anything is changed.
+	word_t regs[SPAWN_MAX_REG][2];
+	for (word_t k = 0; k < nreg; ++k) {
+		regs[k][0] = desc->reg[k].reg;
+		regs[k][1] = desc->reg[k].value;
+		if (UNLIKELY(regs[k][0] >= 32)) {
+			return ERR_INVALID_ARGUMENT;
+		}
+	}
+
+	word_t tsl_parent = desc->tsl.parent;
+	word_t tsl_csize = desc->tsl.csize;
+
+#ifdef MULTIKERNEL
+	// The process and its time slice must belong to this hart, as for a batch.
+	if (UNLIKELY(proc_hart(target) != csrr_mhartid())) {
+		return ERR_INVALID_STATE;
+	}
+	if (tsl_csize > 0 && UNLIKELY(tsl_get_hart(owner, tsl_parent) != (int)csrr_mhartid())) {
+		return ERR_INVALID_STATE;
+	}
+#endif
+
+	// Each step is undone if a later step fails.
+	_undo_t undo = {0};
+	int err = _spawn_mem(owner, target, desc, nmem, &undo);
+	if (err == ERR_SUCCESS) {
+		err = _spawn_ipc(owner, target, desc, nipc, &undo);
+	}
+	if (err == ERR_SUCCESS && tsl_csize > 0) {
+		err = tsl_derive(owner, tsl_parent, target, tsl_csize, desc->tsl.enabled, desc->tsl.size);
+		if (err >= 0) {
+			undo.tsl = true;
+			undo.tsl_parent = tsl_parent;
+			undo.tsl_child = err;
+			err = ERR_SUCCESS;
+		}
+	}
+	if (err == ERR_SUCCESS) {
+		err = _spawn_reg(owner, i, regs, nreg, &undo);
+	}
+	if (err == ERR_SUCCESS && desc->resume) {
+		err = mon_resume(owner, i);
+	}
+	if (err < 0) {
+		_rollback(owner, i, target, &undo);
+		return err;
+	}
+
+	for (word_t k = 0; k < nmem; ++k) {
+		desc->mem[k].index = undo.child[k];
+	}
+	if (undo.tsl) {
+		desc->tsl.index = undo.tsl_child;
+	}
+	return ERR_SUCCESS;
+}
@@ -1,16 +1,19 @@
 #include "syscall.h"
 
+#include "chan.h"
 #include "csr.h"
 #include "current.h"
 #include "exception.h"
 #include "ipc.h"
 #include "lock.h"
 #include "macro.h"
+#include "mailbox.h"
 #include "mem.h"
 #include "mon.h"
 #include "preempt.h"
 #include "proc.h"
 #include "rtc.h"
+#include "spawn.h"
 #include "tsl.h"
 #include "ttas.h"
 
@@ -178,7 +181,7 @@ static proc_t *syscall_mon_derive(pid_t pid, word_t args[8])
  */
 static proc_t *syscall_ipc_derive(pid_t pid, word_t args[8])
 {
-	args[0] = ipc_derive(pid, args[1], pid, args[2], args[3], args[4]);
+	args[0] = ipc_derive(pid, args[1], pid, args[2], args[3], args[4], args[5]);
 	return current;
 }
 
@@ -260,12 +263,13 @@ static proc_t *syscall_ipc_delete(pid_t pid, word_t args[8])
 static proc_t *syscall_mem_pmp_get(pid_t pid, word_t args[8])
 {
 	pmp_slot_t slot;
-	mem_perm_t rwx;
-	pmp_addr_t addr;
-	args[0] = mem_pmp_get(pid, args[1], &slot, &rwx, &addr);
+	word_t rwx;
+	pmp_addr_t addr, top;
+	args[0] = mem_pmp_get(pid, args[1], &slot, &rwx, &addr, &top);
 	args[1] = slot;
 	args[2] = rwx;
 	args[3] = addr;
+	args[4] = top;
 	return current;
 }
 
@@ -274,7 +278,7 @@ static proc_t *syscall_mem_pmp_get(pid_t pid, word_t args[8])
  */
 static proc_t *syscall_mem_pmp_set(pid_t pid, word_t args[8])
 {
-	args[0] = mem_pmp_set(pid, args[1], args[2], args[3], args[4]);
+	args[0] = mem_pmp_set(pid, args[1], args[2], args[3], args[4], args[5]);
 	return current;
 }
 
@@ -287,6 +291,15 @@ static proc_t *syscall_mem_pmp_clear(pid_t pid, word_t args[8])
 	return current;
 }
 
+/**
+ * Mark a memory capability as mapped on demand.
+ */
+static proc_t *syscall_mem_pmp_demand(pid_t pid, word_t args[8])
+{
+	args[0] = mem_pmp_demand(pid, args[1]);
+	return current;
+}
+
 /**
  * Enable or disable a time slice capability's minor frame.
  */
@@ -296,6 +309,24 @@ static proc_t *syscall_tsl_set(pid_t pid, word_t args[8])
 	return current;
 }
 
+/**
+ * Add a time slice capability to the gang of another.
+ */
+static proc_t *syscall_tsl_gang_join(pid_t pid, word_t args[8])
+{
+	args[0] = tsl_gang_join(pid, args[1], args[2]);
+	return current;
+}
+
+/**
+ * Remove a time slice capability from its gang.
+ */
+static proc_t *syscall_tsl_gang_leave(pid_t pid, word_t args[8])
+{
+	args[0] = tsl_gang_leave(pid, args[1]);
+	return current;
+}
+
 /**
  * Suspend the process that is being monitored by the specified monitor capability.
  */
@@ -429,6 +460,19 @@ static proc_t *syscall_mon_mem_grant(pid_t pid, word_t args[8])
 	return current;
 }
 
+/**
+ * Mark a memory capability of the process being monitored by the specified monitor capability as mapped on demand.
+ */
+static proc_t *syscall_mon_mem_pmp_demand(pid_t pid, word_t args[8])
+{
+	pid_t target = mon_get_pid(pid, args[1]);
+	args[0] = ERR_INVALID_ACCESS;
+	if (target != INVALID_PID) {
+		args[0] = mem_pmp_demand(target, args[2]);
+	}
+	return current;
+}
+
 /**
  * Grant a time slice capability to the process being monitored by the specified monitor capability.
  */
@@ -515,7 +559,7 @@ static proc_t *syscall_mon_ipc_derive(pid_t pid, word_t args[8])
 	pid_t target = mon_get_pid(pid, args[1]);
 	args[0] = ERR_INVALID_ACCESS;
 	if (target != INVALID_PID) {
-		args[0] = ipc_derive(pid, args[2], target, args[3], args[4], args[5]);
+		args[0] = ipc_derive(pid, args[2], target, args[3], args[4], args[5], args[6]);
 	}
 	return current;
 }
@@ -529,12 +573,13 @@ static proc_t *syscall_mon_mem_pmp_get(pid_t pid, word_t args[8])
 	args[0] = ERR_INVALID_ACCESS;
 	if (target != INVALID_PID) {
 		pmp_slot_t slot;
-		mem_perm_t rwx;
-		pmp_addr_t addr;
-		args[0] = mem_pmp_get(target, args[2], &slot, &rwx, &addr);
+		word_t rwx;
+		pmp_addr_t addr, top;
+		args[0] = mem_pmp_get(target, args[2], &slot, &rwx, &addr, &top);
 		args[1] = slot;
 		args[2] = rwx;
 		args[3] = addr;
+		args[4] = top;
 	}
 	return current;
 }
@@ -547,7 +592,7 @@ static proc_t *syscall_mon_mem_pmp_set(pid_t pid, word_t args[8])
 	pid_t target = mon_get_pid(pid, args[1]);
 	args[0] = ERR_INVALID_ACCESS;
 	if (target != INVALID_PID) {
-		args[0] = mem_pmp_set(target, args[2], args[3], args[4], args[5]);
+		args[0] = mem_pmp_set(target, args[2], args[3], args[4], args[5], args[6]);
 	}
 	return current;
 }
@@ -584,18 +629,20 @@ static proc_t *syscall_mon_tsl_set(pid_t pid, word_t args[8])
 static proc_t *syscall_ipc_send(pid_t pid, word_t args[8])
 {
 	proc_t *next = current;
-	word_t data[2] = {args[2], args[3]};
-	args[0] = ipc_send(pid, args[1], data, args[4], args[5], &next);
+	ipc_msg_t msg;
+	ipc_msg_get(current, &msg);
+	args[0] = ipc_send(pid, args[1], &msg, &next);
 	return next;
 }
 
 /**
- * Wait to receive an IPC message (synchronous, bidirectional/unidirectional IPC).
+ * Wait to receive an IPC message (synchronous, bidirectional/unidirectional IPC),
+ * args[3] = memory capability, args[4] = base, args[5] = size of a destination for ipc_copy.
  */
 static proc_t *syscall_ipc_recv(pid_t pid, word_t args[8])
 {
 	proc_t *next = current;
-	args[0] = ipc_recv(pid, args[1], &next, args[2]);
+	args[0] = ipc_recv(pid, args[1], &next, args[2], args[3], args[4], args[5]);
 	return next;
 }
 
@@ -605,19 +652,37 @@ static proc_t *syscall_ipc_recv(pid_t pid, word_t args[8])
 static proc_t *syscall_ipc_call(pid_t pid, word_t args[8])
 {
 	proc_t *next = current;
-	word_t data[2] = {args[2], args[3]};
-	args[0] = ipc_call(pid, args[1], data, args[4], args[5], &next);
+	ipc_msg_t msg;
+	ipc_msg_get(current, &msg);
+	args[0] = ipc_call(pid, args[1], &msg, &next);
 	return next;
 }
 
 /**
- * Send a reply to an IPC call.
+ * Copy memory to the receiver of a BSYNC source and call it, args[1] = source, args[2] = tag,
+ * args[3] = memory capability, args[4] = base, args[5] = size. A preempted copy returns the
+ * bytes copied so far in args[1] and is resumed by invoking it again.
+ */
+static proc_t *syscall_ipc_copy(pid_t pid, word_t args[8])
+{
+	proc_t *next = current;
+	word_t done;
+	args[0] = ipc_copy(pid, args[1], args[3], args[4], args[5], args[2], &done, &next);
+	if (args[0] == (word_t)ERR_PREEMPTED) {
+		args[1] = done;
+	}
+	return next;
+}
+
+/**
+ * Send a reply to an IPC call, args[1] is a sink or the reply capability of a call.
  */
 static proc_t *syscall_ipc_reply(pid_t pid, word_t args[8])
 {
 	proc_t *next = current;
-	word_t data[2] = {args[2], args[3]};
-	args[0] = ipc_reply(pid, args[1], data, args[4], args[5], &next);
+	ipc_msg_t msg;
+	ipc_msg_get(current, &msg);
+	args[0] = ipc_reply(pid, args[1], &msg, &next);
 	return next;
 }
 
@@ -627,8 +692,9 @@ static proc_t *syscall_ipc_reply(pid_t pid, word_t args[8])
 static proc_t *syscall_ipc_replyrecv(pid_t pid, word_t args[8])
 {
 	proc_t *next = current;
-	word_t data[2] = {args[2], args[3]};
-	args[0] = ipc_replyrecv(pid, args[1], data, args[4], args[5], &next, args[6]);
+	ipc_msg_t msg;
+	ipc_msg_get(current, &msg);
+	args[0] = ipc_replyrecv(pid, args[1], &msg, &next, args[6]);
 	return next;
 }
 
@@ -654,11 +720,287 @@ static proc_t *syscall_ipc_arecv(pid_t pid, word_t args[8])
 	return next;
 }
 
+/**
+ * Receive from an asynchronous IPC channel, waiting if nothing is pending,
+ * args[1] = sink, args[2] = timeout (0 waits without a timeout).
+ */
+static proc_t *syscall_ipc_arecv_wait(pid_t pid, word_t args[8])
+{
+	proc_t *next = current;
+	word_t data = 0;
+	args[0] = ipc_arecv_wait(pid, args[1], &data, args[2], &next);
+	args[1] = data;
+	return next;
+}
+
+/**
+ * Add a sink to an endpoint set, args[1] = sink in the set, args[2] = joining sink.
+ */
+static proc_t *syscall_ipc_set_join(pid_t pid, word_t args[8])
+{
+	args[0] = ipc_set_join(pid, args[1], args[2]);
+	return current;
+}
+
+/**
+ * Remove a sink from its endpoint set.
+ */
+static proc_t *syscall_ipc_set_leave(pid_t pid, word_t args[8])
+{
+	args[0] = ipc_set_leave(pid, args[1]);
+	return current;
+}
+
+/**
+ * Receive from any member of an endpoint set, waiting if nothing is pending,
+ * args[1] = sink, args[2] = service time, args[3] = timeout (0 waits without a timeout).
+ * The message is returned in args[1-4] as for ipc_recv, and the index of the member in args[5],
+ * ipc_set_wait writes them directly since a waiting caller's message is delivered like a send.
+ */
+static proc_t *syscall_ipc_set_wait(pid_t pid, word_t args[8])
+{
+	proc_t *next = current;
+	args[0] = ipc_set_wait(pid, args[1], args[2], args[3], &next);
+	return next;
+}
+
+/**
+ * Drain the message queue of an asynchronous IPC channel,
+ * args[1] = sink, args[2] = buffer, args[3] = count.
+ */
+static proc_t *syscall_ipc_adrain(pid_t pid, word_t args[8])
+{
+	word_t *buf = (word_t *)args[2];
+	word_t count = args[3];
+
+	if ((args[2] % sizeof(word_t)) != 0) {
+		args[0] = ERR_INVALID_ARGUMENT;
+		return current;
+	}
+	// No more than a full queue is written, so only that part of the buffer is checked.
+	if (count > MAX_IPC_QUEUE) {
+		count = MAX_IPC_QUEUE;
+	}
+	if (count > 0 && !proc_pmp_check(pid, args[2], count * sizeof(word_t), MEM_PERM_RW)) {
+		args[0] = ERR_INVALID_ACCESS;
+		return current;
+	}
+	args[0] = ipc_adrain(pid, args[1], buf, count);
+	return current;
+}
+
+/**
+ * Get the kernel lock statistics of a hart.
+ */
+static proc_t *syscall_lock_stat(pid_t pid, word_t args[8])
+{
+	(void)pid;
+	lock_stat_t stat;
+	args[0] = lock_stat_get(args[1], &stat);
+	args[1] = stat.acquired;
+	args[2] = stat.contended;
+	args[3] = stat.wait;
+	return current;
+}
+
+/**
+ * List the indices of the current process's capabilities of a type,
+ * args[1] = type, args[2] = buffer, args[3] = count, args[4] = offset.
+ */
+static proc_t *syscall_cap_list(pid_t pid, word_t args[8])
+{
+	index_t *buf = (index_t *)args[2];
+	word_t count = args[3];
+	word_t offset = args[4];
+
+	if ((args[2] % sizeof(index_t)) != 0 || count > (~(word_t)0 / sizeof(index_t))) {
+		args[0] = ERR_INVALID_ARGUMENT;
+		return current;
+	}
+	if (count > 0 && !proc_pmp_check(pid, args[2], count * sizeof(index_t), MEM_PERM_RW)) {
+		args[0] = ERR_INVALID_ACCESS;
+		return current;
+	}
+
+	switch (args[1]) {
+	case CAPTY_MEM:
+		args[0] = mem_list(pid, buf, count, offset);
+		break;
+	case CAPTY_TSL:
+		args[0] = tsl_list(pid, buf, count, offset);
+		break;
+	case CAPTY_MON:
+		args[0] = mon_list(pid, buf, count, offset);
+		break;
+	case CAPTY_IPC:
+		args[0] = ipc_list(pid, buf, count, offset);
+		break;
+	default:
+		args[0] = ERR_INVALID_ARGUMENT;
+		break;
+	}
+	return current;
+}
+
+/**
+ * Reclaim the fuel of deleted children at the allocation frontier of a capability,
+ * args[1] = type, args[2] = index.
+ */
+static proc_t *syscall_cap_reclaim(pid_t pid, word_t args[8])
+{
+	switch (args[1]) {
+	case CAPTY_MEM:
+		args[0] = mem_reclaim(pid, args[2]);
+		break;
+	case CAPTY_TSL:
+		args[0] = tsl_reclaim(pid, args[2]);
+		break;
+	case CAPTY_MON:
+		args[0] = mon_reclaim(pid, args[2]);
+		break;
+	case CAPTY_IPC:
+		args[0] = ipc_reclaim(pid, args[2]);
+		break;
+	default:
+		args[0] = ERR_INVALID_ARGUMENT;
+		break;
+	}
+	return current;
+}
+
+/**
+ * Revoke a single child of a capability and its subtree, args[1] = type, args[2] = index, args[3] = child.
+ */
+static proc_t *syscall_cap_revoke_child(pid_t pid, word_t args[8])
+{
+	switch (args[1]) {
+	case CAPTY_MEM:
+		args[0] = mem_revoke_child(pid, args[2], args[3]);
+		break;
+	case CAPTY_TSL:
+		args[0] = tsl_revoke_child(pid, args[2], args[3]);
+		break;
+	case CAPTY_MON:
+		args[0] = mon_revoke_child(pid, args[2], args[3]);
+		break;
+	case CAPTY_IPC:
+		args[0] = ipc_revoke_child(pid, args[2], args[3]);
+		break;
+	default:
+		args[0] = ERR_INVALID_ARGUMENT;
+		break;
+	}
+	return current;
+}
+
+/**
+ * Build the process monitored by a monitor capability from a descriptor,
+ * args[1] = monitor capability, args[2] = descriptor.
+ */
+static proc_t *syscall_spawn(pid_t pid, word_t args[8])
+{
+	if ((args[2] % sizeof(word_t)) != 0 || !proc_pmp_check(pid, args[2], sizeof(spawn_t), MEM_PERM_RW)) {
+		args[0] = ERR_INVALID_ACCESS;
+		return current;
+	}
+	args[0] = spawn(pid, args[1], (spawn_t *)args[2]);
+	return current;
+}
+
+/**
+ * Establish a shared-memory channel between two monitored processes, args[1] = descriptor.
+ */
+static proc_t *syscall_chan_create(pid_t pid, word_t args[8])
+{
+	if ((args[1] % sizeof(word_t)) != 0 || !proc_pmp_check(pid, args[1], sizeof(chan_t), MEM_PERM_RW)) {
+		args[0] = ERR_INVALID_ACCESS;
+		return current;
+	}
+	args[0] = chan_create(pid, (chan_t *)args[1]);
+	return current;
+}
+
+_Static_assert(sizeof(mem_t) <= 2 * sizeof(word_t) && sizeof(tsl_t) <= 2 * sizeof(word_t)
+		       && sizeof(mon_t) <= 2 * sizeof(word_t) && sizeof(ipc_t) <= 2 * sizeof(word_t),
+	       "Capabilities do not fit in an introspection entry.");
+
+/**
+ * Copies entries [offset, offset + n) of the subtable of a process's capability to a buffer
+ * of the current process, two words per entry. Stops at the first invalid entry.
+ */
+static int _introspect_range(pid_t owner, word_t type, index_t i, word_t offset, word_t n, word_t buf)
+{
+	if ((buf % sizeof(word_t)) != 0 || n > (~(word_t)0 / (2 * sizeof(word_t))) || offset + n < offset) {
+		return ERR_INVALID_ARGUMENT;
+	}
+	if (n > 0 && !proc_pmp_check(current->pid, buf, n * 2 * sizeof(word_t), MEM_PERM_RW)) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	word_t *entries = (word_t *)buf;
+	for (word_t k = 0; k < n; k++) {
+		word_t *entry = &entries[2 * k];
+		fuel_t off = offset + k;
+		if (off != offset + k) {
+			return ERR_INVALID_ARGUMENT;
+		}
+
+		int err;
+		switch (type) {
+		case CAPTY_MEM:
+			err = mem_introspect(owner, i, off, (mem_t *)entry);
+			break;
+		case CAPTY_TSL:
+			err = tsl_introspect(owner, i, off, (tsl_t *)entry);
+			break;
+		case CAPTY_MON:
+			err = mon_introspect(owner, i, off, (mon_t *)entry);
+			break;
+		case CAPTY_IPC:
+			err = ipc_introspect(owner, i, off, (ipc_t *)entry);
+			break;
+		default:
+			err = ERR_INVALID_ARGUMENT;
+			break;
+		}
+		if (err < 0) {
+			return err;
+		}
+	}
+	return ERR_SUCCESS;
+}
+
+/**
+ * Get a range of a capability's subtable, args[1] = type, args[2] = index, args[3] = offset,
+ * args[4] = number of entries, args[5] = buffer.
+ */
+static proc_t *syscall_cap_introspect(pid_t pid, word_t args[8])
+{
+	args[0] = _introspect_range(pid, args[1], args[2], args[3], args[4], args[5]);
+	return current;
+}
+
+/**
+ * Get a range of a capability's subtable of the process being monitored by the specified monitor capability,
+ * args[2] = type, args[3] = index, args[4] = offset, args[5] = number of entries, args[6] = buffer.
+ */
+static proc_t *syscall_mon_cap_introspect(pid_t pid, word_t args[8])
+{
+	pid_t target = mon_get_pid(pid, args[1]);
+	args[0] = ERR_INVALID_ACCESS;
+	if (target != INVALID_PID) {
+		args[0] = _introspect_range(target, args[2], args[3], args[4], args[5], args[6]);
+	}
+	return current;
+}
+
 /**
  * Handler type for system calls.
  */
 typedef proc_t *(*handler_t)(pid_t pid, word_t args[8]);
 
+static proc_t *syscall_batch(pid_t pid, word_t args[8]);
+
 /**
  * Handlers for individual system calls.
  */
@@ -718,8 +1060,290 @@ handler_t handlers[] = {
 	syscall_ipc_replyrecv,
 	syscall_ipc_asend,
 	syscall_ipc_arecv,
+	syscall_lock_stat,
+	syscall_tsl_gang_join,
+	syscall_tsl_gang_leave,
+	syscall_batch,
+	syscall_cap_list,
+	syscall_cap_introspect,
+	syscall_mon_cap_introspect,
+	syscall_mem_pmp_demand,
+	syscall_mon_mem_pmp_demand,
+	syscall_cap_reclaim,
+	syscall_cap_revoke_child,
+	syscall_spawn,
+	syscall_ipc_adrain,
+	syscall_ipc_arecv_wait,
+	syscall_ipc_set_join,
+	syscall_ipc_set_leave,
+	syscall_ipc_set_wait,
+	syscall_chan_create,
+	syscall_ipc_copy,
 };
 
+#ifdef MULTIKERNEL
+/**
+ * Mailboxes of the system calls forwarded to each hart.
+ */
+static mailbox_t mailboxes[NUM_HARTS];
+
+/**
+ * Checks if a handler operates on the process of a monitor capability (args[1]).
+ */
+static bool _targets_monitored(handler_t handler)
+{
+	return handler == syscall_mon_yield || handler == syscall_mon_reg_get || handler == syscall_mon_reg_set
+	       || handler == syscall_mon_vreg_get || handler == syscall_mon_vreg_set
+	       || handler == syscall_mon_mem_introspect || handler == syscall_mon_mon_introspect
+	       || handler == syscall_mon_ipc_introspect || handler == syscall_mon_mem_pmp_get
+	       || handler == syscall_mon_mem_pmp_set || handler == syscall_mon_mem_pmp_clear
+	       || handler == syscall_mon_mem_pmp_demand;
+}
+
+/**
+ * Checks if a handler delivers to the peer of an IPC capability (args[1]).
+ */
+static bool _targets_peer(handler_t handler)
+{
+	return handler == syscall_ipc_send || handler == syscall_ipc_call || handler == syscall_ipc_reply
+	       || handler == syscall_ipc_replyrecv || handler == syscall_ipc_asend || handler == syscall_ipc_copy;
+}
+
+/**
+ * Finds the hart owning the state a system call modifies.
+ *
+ * Time slice operations run on the hart of the time slice, since they modify its schedule.
+ * Monitor operations run on the hart of the monitored process, and IPC invocations on the hart of the peer.
+ * Other system calls only touch the caller's own capabilities and run on the caller's hart.
+ */
+static hart_t syscall_hart(pid_t pid, word_t *args)
+{
+	handler_t handler = handlers[args[0]];
+	int hart = csrr_mhartid();
+	pid_t target = INVALID_PID;
+
+	if (handler == syscall_tsl_derive || handler == syscall_tsl_revoke || handler == syscall_tsl_delete
+	    || handler == syscall_tsl_set || handler == syscall_tsl_gang_leave) {
+		hart = tsl_get_hart(pid, args[1]);
+	} else if (handler == syscall_mon_tsl_grant || handler == syscall_mon_tsl_derive) {
+		hart = tsl_get_hart(pid, args[2]);
+	} else if ((handler == syscall_cap_reclaim || handler == syscall_cap_revoke_child) && args[1] == CAPTY_TSL) {
+		hart = tsl_get_hart(pid, args[2]);
+	} else if (handler == syscall_mon_tsl_set || handler == syscall_mon_tsl_introspect) {
+		pid_t owner = mon_get_pid(pid, args[1]);
+		hart = (owner != INVALID_PID) ? tsl_get_hart(owner, args[2]) : ERR_INVALID_ACCESS;
+	} else if (handler == syscall_mon_cap_introspect) {
+		pid_t owner = mon_get_pid(pid, args[1]);
+		if (args[2] == CAPTY_TSL) {
+			hart = (owner != INVALID_PID) ? tsl_get_hart(owner, args[3]) : ERR_INVALID_ACCESS;
+		} else {
+			target = owner;
+		}
+	} else if (_targets_monitored(handler)) {
+		target = mon_get_pid(pid, args[1]);
+	} else if (_targets_peer(handler)) {
+		target = ipc_get_peer(pid, args[1]);
+	}
+
+	if (target != INVALID_PID) {
+		return proc_hart(target);
+	}
+	// Invalid capabilities fail on the caller's hart.
+	return (hart >= 0) ? (hart_t)hart : csrr_mhartid();
+}
+#endif
+
+/**
+ * Invokes a system call handler for a process.
+ */
+static proc_t *syscall_invoke(pid_t pid, word_t *args)
+{
+#ifdef MULTIKERNEL
+	if (_targets_monitored(handlers[args[0]])) {
+		pid_t target = mon_get_pid(pid, args[1]);
+		if (target != INVALID_PID && target != pid && proc_is_forwarded(target)) {
+			// Another hart may be servicing a call of the target.
+			args[0] = ERR_INVALID_STATE;
+			return current;
+		}
+	}
+#endif
+	return handlers[args[0]](pid, args);
+}
+
+/**
+ * Checks if a system call may be part of a batch.
+ * Only calls that never switch process and return a status or index in args[0] are allowed.
+ */
+static bool _batchable(handler_t handler)
+{
+	return handler != syscall_vreg_get && handler != syscall_sync && handler != syscall_sleep_until
+	       && handler != syscall_mon_yield && handler != syscall_ipc_send && handler != syscall_ipc_recv
+	       && handler != syscall_ipc_call && handler != syscall_ipc_reply && handler != syscall_ipc_replyrecv
+	       && handler != syscall_ipc_asend && handler != syscall_ipc_arecv && handler != syscall_ipc_arecv_wait
+	       && handler != syscall_ipc_set_wait && handler != syscall_ipc_copy && handler != syscall_batch;
+}
+
+/**
+ * Executes a batch of system calls, args[1] = operations, args[2] = count, args[3] = cursor.
+ *
+ * Each operation is eight words laid out like the registers a0-a7 of a system call,
+ * the number in bits 0-7 of the first word. Bit 8+k of the first word replaces argument k
+ * with the result of the previous operation. Results are written back in place.
+ */
+static proc_t *syscall_batch(pid_t pid, word_t args[8])
+{
+	word_t *ops = (word_t *)args[1];
+	word_t count = args[2];
+	word_t cursor = args[3];
+
+	if ((args[1] % sizeof(word_t)) != 0 || count > (~(word_t)0 / (8 * sizeof(word_t)))) {
+		args[0] = ERR_INVALID_ARGUMENT;
+		return current;
+	}
+	if (!proc_pmp_check(pid, args[1], count * 8 * sizeof(word_t), MEM_PERM_RW)) {
+		args[0] = ERR_INVALID_ACCESS;
+		return current;
+	}
+
+	args[0] = ERR_SUCCESS;
+	while (cursor < count) {
+		word_t *buf = &ops[cursor * 8];
+		word_t op[8];
+
+		// Our own operations may change the PMP configuration.
+		if (!proc_pmp_check(pid, (word_t)buf, sizeof(op), MEM_PERM_RW)) {
+			args[0] = ERR_INVALID_ACCESS;
+			break;
+		}
+		for (int k = 0; k < 8; k++) {
+			op[k] = buf[k];
+		}
+
+		word_t nr = op[0] & 0xFF;
+		word_t links = (op[0] >> 8) & 0xFE;
+		if (nr >= ARRAY_SIZE(handlers) || !_batchable(handlers[nr]) || (links && cursor == 0)) {
+			args[0] = ERR_INVALID_ARGUMENT;
+			break;
+		}
+		for (int k = 1; k < 8; k++) {
+			if (links & (1 << k)) {
+				op[k] = ops[(cursor - 1) * 8];
+			}
+		}
+
+		op[0] = nr;
+#ifdef MULTIKERNEL
+		if (syscall_hart(pid, op) != csrr_mhartid()) {
+			// Operations on other harts' state must be made as separate calls.
+			op[0] = ERR_INVALID_STATE;
+		} else
+#endif
+			syscall_invoke(pid, op);
+
+		if (!proc_pmp_check(pid, (word_t)buf, sizeof(op), MEM_PERM_RW)) {
+			args[0] = ERR_INVALID_ACCESS;
+			break;
+		}
+		for (int k = 0; k < 8; k++) {
+			buf[k] = op[k];
+		}
+
+		if ((long)op[0] < 0) {
+			args[0] = op[0];
+			break;
+		}
+		cursor++;
+		if (cursor < count && preempt()) {
+			args[0] = ERR_PREEMPTED;
+			break;
+		}
+	}
+	args[1] = cursor;
+	return current;
+}
+
+#ifdef MULTIKERNEL
+/**
+ * Forwards the current process's system call to another hart.
+ * The hart is interrupted and services the call when it next switches process.
+ */
+static proc_t *syscall_forward(hart_t hart)
+{
+	// The servicing hart acquires the process after this hart has switched it out.
+	proc_forward(current->pid);
+	if (!mailbox_push(&mailboxes[hart], current->pid)) {
+		// Mailbox full, the process retries the call.
+		proc_forward_cancel(current->pid);
+	} else {
+		// Wake the hart if it is idle.
+		rtc_send_ipi(hart);
+	}
+	return NULL;
+}
+
+/**
+ * Services a forwarded system call of an acquired process.
+ */
+static void syscall_service(proc_t *proc)
+{
+	word_t *args = &proc->regs.a0;
+	hart_t hart = syscall_hart(proc->pid, args);
+
+	if (hart != csrr_mhartid()) {
+		// The routing state changed, or this is a stale request. Forward it again.
+		proc_release(proc->pid);
+		if (!mailbox_push(&mailboxes[hart], proc->pid)) {
+			proc_forward_cancel(proc->pid);
+		} else {
+			rtc_send_ipi(hart);
+		}
+		return;
+	}
+
+	// Run the handler as the caller.
+	proc_t *self = current;
+	current = proc;
+	proc->regs.pc += 4;
+	proc_t *next = syscall_invoke(proc->pid, args);
+	current = self;
+
+	if (next != NULL) {
+		// The caller was not blocked, it continues on its own hart as soon as possible.
+		proc->timeout = 0;
+		if (next != proc) {
+			// Time is not donated across harts, the receiver runs in its own time slots.
+			next->timeout = 0;
+			proc_release(next->pid);
+		}
+	}
+	proc_forward_release(proc->pid);
+}
+
+/**
+ * Services the system calls forwarded to this hart.
+ */
+bool syscall_drain(void)
+{
+	mailbox_t *mb = &mailboxes[csrr_mhartid()];
+	pid_t pid;
+
+	while (mailbox_peek(mb, &pid)) {
+		bool acquired = proc_forward_acquire(pid);
+		if (!acquired && proc_is_forwarded(pid)) {
+			// Its hart has not switched it out yet, try again at the next kernel entry.
+			return true;
+		}
+		// Requests of cancelled or already serviced calls are dropped.
+		mailbox_pop(mb);
+		if (acquired) {
+			syscall_service(proc_get(pid));
+		}
+	}
+	return false;
+}
+#endif
+
 /**
  * System call handler.
  */
@@ -738,11 +1362,27 @@ proc_t *syscall_handler(void)
 		return NULL;
 	}
 
+#ifdef MULTIKERNEL
+	// Service calls forwarded to this hart, then forward this call if another hart owns its state.
+	syscall_drain();
+	hart_t hart = syscall_hart(current->pid, &current->regs.a0);
+	if (hart != csrr_mhartid()) {
+		lock_release();
+		return syscall_forward(hart);
+	}
+#endif
+
 	// Advance the program counter.
 	current->regs.pc += 4;
 
 	// Call the system call handler
-	proc_t *next = handlers[syscall_nr](current->pid, &current->regs.a0);
+	proc_t *next = syscall_invoke(current->pid, &current->regs.a0);
+
+	// Invalidate some of the capabilities revoked by earlier calls.
+	mem_sweep();
+	tsl_sweep();
+	mon_sweep();
+	ipc_sweep();
 
 	// Releases the lock.
 	lock_release();
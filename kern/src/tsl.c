@@ -1,8 +1,9 @@
 #include "tsl.h"
 
 #include "macro.h"
-#include "preempt.h"
+#include "owner.h"
 #include "proc.h"
+#include "revoke.h"
 #include "sched.h"
 
 /**
@@ -10,6 +11,51 @@
  */
 static tsl_t tsl_table[TSL_TABLE_SIZE];
 
+#ifdef CAP_SOA
+/**
+ * Owners of the time slice capabilities, kept apart from the table so ownership checks and sweeps
+ * stream through a dense array. The owner fields of the table entries are unused.
+ */
+static pid_t tsl_owners[TSL_TABLE_SIZE];
+#endif
+
+/**
+ * The owner of the time slice capability at index i.
+ */
+static inline pid_t *_owner(index_t i)
+{
+#ifdef CAP_SOA
+	return &tsl_owners[i];
+#else
+	return &tsl_table[i].owner;
+#endif
+}
+
+/**
+ * Processes run in the time slots of the time slice capabilities. A capability runs its owner,
+ * except a gang member transferred to another process, the gang stays under its owner's control.
+ */
+static pid_t tsl_pids[TSL_TABLE_SIZE];
+
+/**
+ * Pending revocations of the time slice table.
+ */
+static revoke_log_t tsl_revoked;
+
+/**
+ * Ownership lists of the time slice table.
+ */
+static owner_link_t tsl_links[TSL_TABLE_SIZE];
+static owner_index_t tsl_owned;
+
+/**
+ * The ownership links of a time slice capability.
+ */
+static owner_link_t *_link(index_t i)
+{
+	return &tsl_links[i];
+}
+
 /**
  * Initializes the time slice capabilities.
  */
@@ -18,15 +64,18 @@ void tsl_init()
 	// Create an initial time slice capability for each hardware thread.
 	for (int i = 0; i < NUM_HARTS; ++i) {
 		tsl_table[i * MAX_TIME_FUEL] = (tsl_t){
-			.owner = 1,
 			.base = 0,
 			.hart = i,
 			.cfree = MAX_TIME_FUEL,
 			.csize = MAX_TIME_FUEL,
 			.free = MAX_TIME_SLOT,
 			.size = MAX_TIME_SLOT,
-			.enabled = (i == 0) // Enable the first hart by default.,
+			.enabled = (i == 0), // Enable the first hart by default.
+			.gang = i * MAX_TIME_FUEL,
 		};
+		*_owner(i * MAX_TIME_FUEL) = 1;
+		tsl_pids[i * MAX_TIME_FUEL] = 1;
+		owner_set(&tsl_owned, i * MAX_TIME_FUEL, 1, _link);
 	}
 }
 
@@ -35,7 +84,18 @@ void tsl_init()
  */
 bool tsl_valid_access(pid_t owner, index_t i)
 {
-	return i < ARRAY_SIZE(tsl_table) && tsl_table[i].owner == owner;
+	return i < ARRAY_SIZE(tsl_table) && *_owner(i) == owner && !revoke_stale(&tsl_revoked, i);
+}
+
+/**
+ * Retrieves the hart of a time slice capability.
+ */
+int tsl_get_hart(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!tsl_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+	return tsl_table[i].hart;
 }
 
 /**
@@ -46,6 +106,66 @@ static bool _derivable(tsl_t parent, fuel_t csize, time_slot_t size)
 	return parent.cfree > csize && size <= parent.free && csize > 0 && size > 0;
 }
 
+/**
+ * Finds the member preceding i in its gang.
+ */
+static index_t _gang_prev(index_t i)
+{
+	index_t k = i;
+	while (tsl_table[k].gang != i)
+		k = tsl_table[k].gang;
+	return k;
+}
+
+/**
+ * Removes a time slice capability from its gang.
+ */
+static void _gang_unlink(index_t i)
+{
+	tsl_table[_gang_prev(i)].gang = tsl_table[i].gang;
+	tsl_table[i].gang = i;
+}
+
+/**
+ * Finds the member following k in its gang, unlinking revoked members on the way.
+ */
+static index_t _gang_next(index_t k)
+{
+	index_t next = tsl_table[k].gang;
+	while (next != k && revoke_stale(&tsl_revoked, next)) {
+		tsl_table[k].gang = tsl_table[next].gang;
+		tsl_table[next].gang = next;
+		next = tsl_table[k].gang;
+	}
+	return next;
+}
+
+/**
+ * Checks that every member of the gang of i is owned by owner, the owner controls the gang
+ * while each member runs its own process.
+ */
+static bool _gang_owned(pid_t owner, index_t i)
+{
+	index_t k = i;
+	do {
+		if (*_owner(k) != owner)
+			return false;
+		k = _gang_next(k);
+	} while (k != i);
+	return true;
+}
+
+/**
+ * Invalidates a stale time slice capability, its time slots were reclaimed when it was revoked.
+ */
+static void _sweep(index_t i)
+{
+	// Deleted and never derived entries are in no gang.
+	if (*_owner(i) != INVALID_PID)
+		_gang_unlink(i);
+	*_owner(i) = INVALID_PID;
+}
+
 /**
  * Transfers a time slice capability from one process to another.
  */
@@ -55,8 +175,12 @@ int tsl_transfer(pid_t owner, index_t i, pid_t new_owner)
 		return ERR_INVALID_ACCESS;
 	}
 
-	// Update the owner of the capability.
-	tsl_table[i].owner = new_owner;
+	// A gang member stays in its gang under the owner's control, only the process run in its slots changes.
+	if (_gang_next(i) == i) {
+		*_owner(i) = new_owner;
+		owner_set(&tsl_owned, i, new_owner, _link);
+	}
+	tsl_pids[i] = new_owner;
 
 	// Update the scheduler if the capability is enabled.
 	if (tsl_table[i].free > 0) {
@@ -77,22 +201,18 @@ int tsl_introspect(pid_t owner, index_t i, fuel_t offset, tsl_t *cap)
 	}
 
 	*cap = tsl_table[i + offset];
+	cap->owner = *_owner(i + offset);
+	if (revoke_stale(&tsl_revoked, i + offset)) {
+		cap->owner = INVALID_PID;
+	}
 	return ERR_SUCCESS;
 }
 
 /**
- * Derives a new time slice capability from an existing one.
+ * Derives a child of capability i, the caller has checked that it is derivable.
  */
-int tsl_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, bool enable, time_slot_t size)
+static index_t _derive(index_t i, pid_t target, fuel_t csize, bool enable, time_slot_t size)
 {
-	if (UNLIKELY(!tsl_valid_access(owner, i))) {
-		return ERR_INVALID_ACCESS;
-	}
-
-	if (UNLIKELY(!_derivable(tsl_table[i], csize, size))) {
-		return ERR_INVALID_ARGUMENT;
-	}
-
 	// Update the parent capability by reducing its cfree and adjusting its allocation.
 	tsl_table[i].cfree -= csize;
 	tsl_table[i].free -= size;
@@ -103,9 +223,11 @@ int tsl_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, bool enable,
 	// Calculate the start of the new time slice capability
 	time_slot_t base = tsl_table[i].base + tsl_table[i].free;
 
+	// Invalidate a revoked capability at the new index, the rest of the range stays stale.
+	revoke_claim(&tsl_revoked, j, _sweep);
+
 	// Create the new child capability with the specified parameters.
 	tsl_table[j] = (tsl_t){
-		.owner = target,
 		.cfree = csize,
 		.csize = csize,
 		.hart = tsl_table[i].hart,
@@ -113,18 +235,59 @@ int tsl_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, bool enable,
 		.base = base,
 		.size = size,
 		.free = size,
+		.gang = j,
 	};
+	*_owner(j) = target;
+	tsl_pids[j] = target;
+	owner_set(&tsl_owned, j, target, _link);
 
 	// Update the scheduler with the new capability.
 	pid_t sched_pid = enable ? target : INVALID_PID;
 	sched_split(tsl_table[i].hart, sched_pid, tsl_table[i].base, base, base + size);
 
+	return j;
+}
+
+/**
+ * Derives a new time slice capability from an existing one.
+ *
+ * If the capability is in a gang, every member derives the same slot range on
+ * its hart and the children form a new gang.
+ */
+int tsl_derive(pid_t owner, index_t i, pid_t target, fuel_t csize, bool enable, time_slot_t size)
+{
+	if (UNLIKELY(!tsl_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	// Check all members first so the gang is derived atomically.
+	index_t k = i;
+	do {
+		if (UNLIKELY(*_owner(k) != owner)) {
+			return ERR_INVALID_ACCESS;
+		}
+		if (UNLIKELY(!_derivable(tsl_table[k], csize, size) || tsl_table[k].base != tsl_table[i].base
+			     || tsl_table[k].free != tsl_table[i].free)) {
+			return ERR_INVALID_ARGUMENT;
+		}
+		k = _gang_next(k);
+	} while (k != i);
+
+	index_t j = _derive(i, target, csize, enable, size);
+	for (k = tsl_table[i].gang; k != i; k = tsl_table[k].gang) {
+		// Link the child of each member into the gang of j.
+		index_t l = _derive(k, target, csize, enable, size);
+		tsl_table[l].gang = tsl_table[j].gang;
+		tsl_table[j].gang = l;
+	}
+
 	// Return the index of the new capability.
 	return j;
 }
 
 /**
- * Revokes the children of a time slice capability.
+ * Revokes the children of a time slice capability and of the other members of its gang.
+ * Members already revoked by a preempted call are skipped when it is invoked again.
  */
 int tsl_revoke(pid_t owner, index_t i)
 {
@@ -132,28 +295,172 @@ int tsl_revoke(pid_t owner, index_t i)
 		return ERR_INVALID_ACCESS;
 	}
 
-	// Reclaim cfree and invalidate children.
+	if (UNLIKELY(!_gang_owned(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	index_t k = i;
+	do {
+		if (tsl_table[k].cfree < tsl_table[k].csize) {
+			// Record the children as revoked, returns false if preempted while the log was full.
+			index_t begin = k + tsl_table[k].cfree;
+			index_t end = k + tsl_table[k].csize;
+			if (UNLIKELY(!revoke_push(&tsl_revoked, begin, end, _sweep))) {
+				return tsl_table[k].csize - tsl_table[k].cfree;
+			}
+
+			// Reclaim cfree and allocation.
+			tsl_table[k].cfree = tsl_table[k].csize;
+			tsl_table[k].free = tsl_table[k].size;
+
+			// Reclaim the children's time slots in the scheduler before revoke returns.
+			pid_t pid = tsl_table[k].enabled ? tsl_pids[k] : INVALID_PID;
+			sched_reclaim(tsl_table[k].hart, pid, tsl_table[k].base, tsl_table[k].base + tsl_table[k].free);
+		}
+		k = _gang_next(k);
+	} while (k != i);
+
+	return 0;
+}
+
+/**
+ * Check if the capabilities in [begin, end) are deleted or revoked.
+ */
+static bool _dead(index_t begin, index_t end)
+{
+	for (index_t k = begin; k < end; ++k) {
+		if (*_owner(k) != INVALID_PID && !revoke_stale(&tsl_revoked, k))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Check if j is a child of i, the children are laid out back to back from the allocation frontier.
+ */
+static bool _is_child(index_t i, index_t j)
+{
+	for (index_t k = i + tsl_table[i].cfree; k < i + tsl_table[i].csize; k += tsl_table[k].csize) {
+		if (k == j)
+			return true;
+		if (tsl_table[k].csize == 0)
+			return false;
+	}
+	return false;
+}
+
+/**
+ * Returns the fuel and time slots of dead children at the allocation frontier to capability i.
+ */
+static fuel_t _reclaim(index_t i)
+{
+	// Children are allocated downwards, so the most recent child is at the frontier
+	// and its time slots follow the parent's free slots.
+	fuel_t reclaimed = 0;
 	while (tsl_table[i].cfree < tsl_table[i].csize) {
 		index_t j = i + tsl_table[i].cfree;
+		fuel_t csize = tsl_table[j].csize;
+		if (csize == 0 || csize > tsl_table[i].csize - tsl_table[i].cfree || !_dead(j, j + csize))
+			break;
+		tsl_table[i].cfree += csize;
+		tsl_table[i].free += tsl_table[j].size;
+		reclaimed += csize;
+	}
 
-		// Reclaim cfree and allocation.
-		tsl_table[i].cfree += tsl_table[j].cfree;
-		tsl_table[i].free += tsl_table[j].free;
+	// Merge the children's time slots into the parent's minor frame.
+	if (reclaimed > 0) {
+		pid_t pid = tsl_table[i].enabled ? tsl_pids[i] : INVALID_PID;
+		sched_reclaim(tsl_table[i].hart, pid, tsl_table[i].base, tsl_table[i].base + tsl_table[i].free);
+	}
+	return reclaimed;
+}
 
-		// Invalidate the child capability.
-		tsl_table[j].owner = INVALID_PID;
+/**
+ * Returns the fuel and time slots of dead children at the allocation frontier to a time slice capability
+ * and the other members of its gang.
+ */
+int tsl_reclaim(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!tsl_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
 
-		if (UNLIKELY(preempt()))
-			break;
+	if (UNLIKELY(!_gang_owned(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	fuel_t reclaimed = _reclaim(i);
+	for (index_t k = _gang_next(i); k != i; k = _gang_next(k)) {
+		_reclaim(k);
+	}
+	return reclaimed;
+}
+
+/**
+ * Finds the child of k with the time slots [base, base + size), a gang derives the same slots on every member.
+ */
+static bool _child_at(index_t k, time_slot_t base, time_slot_t size, index_t *j)
+{
+	for (index_t l = k + tsl_table[k].cfree; l < k + tsl_table[k].csize; l += tsl_table[l].csize) {
+		if (tsl_table[l].csize == 0)
+			return false;
+		if (tsl_table[l].base == base && tsl_table[l].size == size) {
+			*j = l;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Revokes a single child of a time slice capability and its subtree, and the matching child of
+ * the other members of its gang. Children already revoked by a preempted call are skipped when
+ * it is invoked again, the members are not reclaimed until all children are revoked.
+ */
+int tsl_revoke_child(pid_t owner, index_t i, index_t j)
+{
+	if (UNLIKELY(!tsl_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
 	}
 
-	// Reclaim allocated time slots in the scheduler.
-	pid_t pid = tsl_table[i].enabled ? owner : INVALID_PID;
-	sched_reclaim(tsl_table[i].hart, pid, tsl_table[i].base, tsl_table[i].base + tsl_table[i].free);
+	if (UNLIKELY(!_is_child(i, j))) {
+		return ERR_INVALID_ARGUMENT;
+	}
 
-	// Return the remaining cfree to be revoked.
-	// Is 0 if all children are revoked.
-	return tsl_table[i].csize - tsl_table[i].cfree;
+	// Check all members first so the children are revoked on every member or none.
+	time_slot_t base = tsl_table[j].base;
+	time_slot_t size = tsl_table[j].size;
+	index_t k = i, l;
+	do {
+		if (UNLIKELY(*_owner(k) != owner)) {
+			return ERR_INVALID_ACCESS;
+		}
+		if (UNLIKELY(!_child_at(k, base, size, &l))) {
+			return ERR_INVALID_ARGUMENT;
+		}
+		k = _gang_next(k);
+	} while (k != i);
+
+	do {
+		_child_at(k, base, size, &l);
+		// Record the subtree as revoked, returns false if preempted while the log was full.
+		if (!revoke_stale(&tsl_revoked, l)
+		    && UNLIKELY(!revoke_push(&tsl_revoked, l, l + tsl_table[l].csize, _sweep))) {
+			return tsl_table[l].csize;
+		}
+
+		// The subtree's time slots become one idle frame, the frames of the siblings are untouched.
+		sched_reclaim(tsl_table[k].hart, INVALID_PID, base, base + size);
+		k = _gang_next(k);
+	} while (k != i);
+
+	// Merge the fuel and time slots back if the children were at the allocation frontier.
+	do {
+		_reclaim(k);
+		k = _gang_next(k);
+	} while (k != i);
+
+	return 0;
 }
 
 /**
@@ -166,7 +473,9 @@ int tsl_delete(pid_t owner, index_t i)
 	}
 
 	// Invalidates the capability.
-	tsl_table[i].owner = INVALID_PID;
+	*_owner(i) = INVALID_PID;
+	owner_set(&tsl_owned, i, INVALID_PID, _link);
+	_gang_unlink(i);
 
 	// Deletes the minor frame in the scheduler.
 	if (tsl_table[i].free > 0) {
@@ -177,7 +486,7 @@ int tsl_delete(pid_t owner, index_t i)
 }
 
 /**
- * Enables or disables a time slice capability.
+ * Enables or disables a time slice capability and the other members of its gang.
  */
 int tsl_set(pid_t owner, index_t i, bool enable)
 {
@@ -185,13 +494,90 @@ int tsl_set(pid_t owner, index_t i, bool enable)
 		return ERR_INVALID_ACCESS;
 	}
 
-	// Enable or disable the minor frame in the scheduler.
-	if (tsl_table[i].free > 0) {
-		pid_t sched_pid = enable ? owner : INVALID_PID;
-		sched_set_pid(tsl_table[i].hart, sched_pid, tsl_table[i].base);
+	// Check all members first, as for tsl_derive.
+	if (UNLIKELY(!_gang_owned(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	index_t k = i;
+	do {
+		// Enable or disable the minor frame in the scheduler, each member runs its own process.
+		if (tsl_table[k].free > 0) {
+			pid_t sched_pid = enable ? tsl_pids[k] : INVALID_PID;
+			sched_set_pid(tsl_table[k].hart, sched_pid, tsl_table[k].base);
+		}
+		// Make the time slice capability enabled or disabled.
+		tsl_table[k].enabled = enable;
+		k = _gang_next(k);
+	} while (k != i);
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * Adds time slice capability j to the gang of capability i.
+ */
+int tsl_gang_join(pid_t owner, index_t i, index_t j)
+{
+	if (UNLIKELY(!tsl_valid_access(owner, i) || !tsl_valid_access(owner, j))) {
+		return ERR_INVALID_ACCESS;
 	}
-	// Make the time slice capability enabled or disabled.
-	tsl_table[i].enabled = enable;
+
+#ifdef MULTIKERNEL
+	// A gang would let one hart write the schedule of another.
+	return ERR_INVALID_STATE;
+#endif
+
+	if (UNLIKELY(_gang_next(j) != j)) {
+		// Already in a gang.
+		return ERR_INVALID_STATE;
+	}
+
+	// Members must cover the same slots, in the same state, on distinct harts.
+	if (tsl_table[j].base != tsl_table[i].base || tsl_table[j].free != tsl_table[i].free
+	    || tsl_table[j].enabled != tsl_table[i].enabled) {
+		return ERR_INVALID_ARGUMENT;
+	}
+	index_t k = i;
+	do {
+		if (tsl_table[k].hart == tsl_table[j].hart) {
+			return ERR_INVALID_ARGUMENT;
+		}
+		k = _gang_next(k);
+	} while (k != i);
+
+	tsl_table[j].gang = tsl_table[i].gang;
+	tsl_table[i].gang = j;
 
 	return ERR_SUCCESS;
 }
+
+/**
+ * Removes a time slice capability from its gang.
+ */
+int tsl_gang_leave(pid_t owner, index_t i)
+{
+	if (UNLIKELY(!tsl_valid_access(owner, i))) {
+		return ERR_INVALID_ACCESS;
+	}
+
+	_gang_unlink(i);
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * Lists the time slice capabilities of a process.
+ */
+word_t tsl_list(pid_t owner, index_t *buf, word_t count, word_t offset)
+{
+	return owner_list(&tsl_owned, owner, _link, tsl_valid_access, buf, count, offset);
+}
+
+/**
+ * Sweeps pending revocations of the time slice table.
+ */
+void tsl_sweep(void)
+{
+	revoke_sweep(&tsl_revoked, _sweep);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "s3k/batch.h"	 // Builder for batched system calls.
 #include "s3k/syscall.h" // Provides system call interface definitions.
 #include "s3k/types.h"	 // Includes type definitions used throughout the library.
 #include "s3k/util.h"	 // Utility functions for encoding/decoding addresses and sizes.
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "s3k/syscall.h"
+#include "s3k/types.h"
+
+/**
+ * @struct s3k_batch
+ * @brief Builder for a batched system call.
+ *
+ * Operations are appended to a caller-provided buffer, which must be readable and writable
+ * through the caller's PMP configuration, then executed with s3k_batch_run().
+ */
+typedef struct s3k_batch {
+	s3k_batch_op_t *ops;   ///< Operation buffer.
+	s3k_word_t capacity;   ///< Number of operations the buffer can hold.
+	s3k_word_t count;      ///< Number of operations added.
+	s3k_word_t cursor;     ///< Next operation to execute.
+} s3k_batch_t;
+
+static inline void s3k_batch_init(s3k_batch_t *b, s3k_batch_op_t *ops, s3k_word_t capacity)
+{
+	b->ops = ops;
+	b->capacity = capacity;
+	b->count = 0;
+	b->cursor = 0;
+}
+
+/**
+ * Appends an operation, returns its position or -1 if the buffer is full.
+ */
+static inline int s3k_batch_push(s3k_batch_t *b, s3k_word_t nr, s3k_word_t a1, s3k_word_t a2, s3k_word_t a3,
+				 s3k_word_t a4, s3k_word_t a5, s3k_word_t a6, s3k_word_t a7)
+{
+	if (b->count == b->capacity)
+		return -1;
+	s3k_word_t *args = b->ops[b->count].args;
+	args[0] = nr;
+	args[1] = a1;
+	args[2] = a2;
+	args[3] = a3;
+	args[4] = a4;
+	args[5] = a5;
+	args[6] = a6;
+	args[7] = a7;
+	return b->count++;
+}
+
+/**
+ * Replaces argument @p arg (1-7) of the last operation with the result of the operation before it,
+ * e.g., the index returned by a derive.
+ */
+static inline void s3k_batch_link(s3k_batch_t *b, int arg)
+{
+	if (b->count > 1 && arg > 0 && arg < 8)
+		b->ops[b->count - 1].args[0] |= (s3k_word_t)1 << (8 + arg);
+}
+
+/**
+ * Executes the remaining operations, resuming after preemptions.
+ * Returns S3K_SUCCESS or the error of the first failing operation, at position b->cursor.
+ */
+static inline int s3k_batch_run(s3k_batch_t *b)
+{
+	int err;
+	do {
+		err = s3k_batch(b->ops, b->count, &b->cursor);
+	} while (err == S3K_ERR_PREEMPTED);
+	return err;
+}
+
+/**
+ * Returns the result (a0) of an executed operation.
+ */
+static inline s3k_word_t s3k_batch_result(const s3k_batch_t *b, int k)
+{
+	return b->ops[k].args[0];
+}
+
+static inline int s3k_batch_mem_derive(s3k_batch_t *b, s3k_index_t i, s3k_fuel_t csize, s3k_mem_perm_t perm,
+				       s3k_mem_addr_t base, s3k_mem_addr_t size)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MEM_DERIVE, i, csize, perm, base, size, 0, 0);
+}
+
+static inline int s3k_batch_mem_pmp_set(s3k_batch_t *b, s3k_index_t i, s3k_pmp_slot_t slot, s3k_mem_perm_t perm,
+					s3k_pmp_addr_t addr)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MEM_PMP_SET, i, slot, perm, addr, 0, 0, 0);
+}
+
+static inline int s3k_batch_mon_mem_derive(s3k_batch_t *b, s3k_index_t i, s3k_index_t j, s3k_fuel_t csize,
+					   s3k_mem_perm_t perm, s3k_mem_addr_t base, s3k_mem_addr_t size)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MON_MEM_DERIVE, i, j, csize, perm, base, size, 0);
+}
+
+static inline int s3k_batch_mon_mem_pmp_set(s3k_batch_t *b, s3k_index_t i, s3k_index_t j, s3k_pmp_slot_t slot,
+					    s3k_mem_perm_t perm, s3k_pmp_addr_t addr)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MON_MEM_PMP_SET, i, j, slot, perm, addr, 0, 0);
+}
+
+static inline int s3k_batch_mon_ipc_grant(s3k_batch_t *b, s3k_index_t i, s3k_index_t j)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MON_IPC_GRANT, i, j, 0, 0, 0, 0, 0);
+}
+
+static inline int s3k_batch_mon_reg_set(s3k_batch_t *b, s3k_index_t i, s3k_reg_t reg, s3k_word_t value)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MON_REG_SET, i, reg, value, 0, 0, 0, 0);
+}
+
+static inline int s3k_batch_mon_resume(s3k_batch_t *b, s3k_index_t i)
+{
+	return s3k_batch_push(b, S3K_SYSCALL_MON_RESUME, i, 0, 0, 0, 0, 0, 0);
+}
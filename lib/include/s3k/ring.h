@@ -0,0 +1,210 @@
+#pragma once
+
+#include "s3k/syscall.h"
+#include "s3k/types.h"
+
+#define S3K_RING_LINE 64 ///< Cache line size, the head and the tail are on separate lines.
+
+/**
+ * @struct s3k_ring_buf
+ * @brief Layout of a single-producer single-consumer ring in the buffer of a channel.
+ *
+ * The head is on the first line, so a channel created by s3k_chan_create() with
+ * ack_size = S3K_RING_LINE lets the consumer write it and nothing else. The buffer
+ * must be zeroed before either end uses it, e.g., by the process creating the channel.
+ */
+typedef struct s3k_ring_buf {
+	s3k_word_t head __attribute__((aligned(S3K_RING_LINE))); ///< Bytes read, written by the consumer.
+	s3k_word_t tail __attribute__((aligned(S3K_RING_LINE))); ///< Bytes written, written by the producer.
+	unsigned char data[] __attribute__((aligned(S3K_RING_LINE)));
+} s3k_ring_buf_t;
+
+/**
+ * @struct s3k_ring
+ * @brief One end of a ring, private to the process using it.
+ *
+ * Each end keeps its own position and the last position it read from the other end,
+ * so it only reads the other end's line when the cached position is not enough.
+ */
+typedef struct s3k_ring {
+	s3k_ring_buf_t *buf; ///< The shared buffer.
+	s3k_word_t size;     ///< Capacity in bytes, a power of two.
+	s3k_word_t pos;      ///< Own position, the tail of the producer or the head of the consumer.
+	s3k_word_t peer;     ///< Last position read from the other end.
+	s3k_index_t ipc;     ///< Notification source of the producer or sink of the consumer.
+} s3k_ring_t;
+
+/**
+ * Sets up an end of the ring in a buffer of the given size, with the notification
+ * capability of the end. The capacity is the largest power of two that fits after the header.
+ */
+static inline void _s3k_ring_init(s3k_ring_t *r, void *buf, s3k_word_t size, s3k_index_t ipc)
+{
+	s3k_word_t cap = (size > sizeof(s3k_ring_buf_t)) ? size - sizeof(s3k_ring_buf_t) : 0;
+	r->buf = buf;
+	r->size = 0;
+	if (cap > 0) {
+		r->size = 1;
+		while (r->size <= cap / 2)
+			r->size *= 2;
+	}
+	r->ipc = ipc;
+}
+
+static inline void s3k_ring_init_producer(s3k_ring_t *r, void *buf, s3k_word_t size, s3k_index_t source)
+{
+	_s3k_ring_init(r, buf, size, source);
+	r->pos = __atomic_load_n(&r->buf->tail, __ATOMIC_RELAXED);
+	r->peer = __atomic_load_n(&r->buf->head, __ATOMIC_ACQUIRE);
+}
+
+static inline void s3k_ring_init_consumer(s3k_ring_t *r, void *buf, s3k_word_t size, s3k_index_t sink)
+{
+	_s3k_ring_init(r, buf, size, sink);
+	r->pos = __atomic_load_n(&r->buf->head, __ATOMIC_RELAXED);
+	r->peer = __atomic_load_n(&r->buf->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Returns the contiguous free space at the tail and sets *ptr to it, for the producer to fill
+ * in place. Reads the consumer's head only if the cached one leaves less than @p want bytes.
+ */
+static inline s3k_word_t s3k_ring_reserve(s3k_ring_t *r, void **ptr, s3k_word_t want)
+{
+	s3k_word_t off = r->pos & (r->size - 1);
+	s3k_word_t free = r->size - (r->pos - r->peer);
+	if (free < want) {
+		r->peer = __atomic_load_n(&r->buf->head, __ATOMIC_ACQUIRE);
+		free = r->size - (r->pos - r->peer);
+	}
+	*ptr = &r->buf->data[off];
+	return (r->size - off < free) ? r->size - off : free;
+}
+
+/**
+ * Publishes n reserved bytes. Signals the consumer only if the ring was empty, so a
+ * consumer that is draining the ring is not woken for every commit.
+ * Returns S3K_SUCCESS or the error of the signal.
+ */
+static inline int s3k_ring_commit(s3k_ring_t *r, s3k_word_t n)
+{
+	s3k_word_t tail = r->pos;
+	if (n == 0)
+		return S3K_SUCCESS;
+	r->pos = tail + n;
+	__atomic_store_n(&r->buf->tail, r->pos, __ATOMIC_RELEASE);
+	// Orders the store of the tail before the load of the head, pairs with the fence in s3k_ring_wait.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	r->peer = __atomic_load_n(&r->buf->head, __ATOMIC_ACQUIRE);
+	if (r->peer == tail)
+		return s3k_ipc_asend(r->ipc, 1);
+	return S3K_SUCCESS;
+}
+
+/**
+ * Returns the contiguous data at the head and sets *ptr to it, for the consumer to read
+ * in place. Reads the producer's tail only if the cached one shows no data.
+ */
+static inline s3k_word_t s3k_ring_peek(s3k_ring_t *r, const void **ptr)
+{
+	s3k_word_t off = r->pos & (r->size - 1);
+	if (r->peer == r->pos)
+		r->peer = __atomic_load_n(&r->buf->tail, __ATOMIC_ACQUIRE);
+	s3k_word_t avail = r->peer - r->pos;
+	*ptr = &r->buf->data[off];
+	return (r->size - off < avail) ? r->size - off : avail;
+}
+
+/**
+ * Frees n bytes read with s3k_ring_peek.
+ */
+static inline void s3k_ring_release(s3k_ring_t *r, s3k_word_t n)
+{
+	r->pos += n;
+	__atomic_store_n(&r->buf->head, r->pos, __ATOMIC_RELEASE);
+}
+
+/**
+ * Waits until the ring is not empty. Returns S3K_SUCCESS, or S3K_ERR_TIMEOUT if
+ * timeout passes first, as for s3k_ipc_arecv_wait.
+ */
+static inline int s3k_ring_wait(s3k_ring_t *r, s3k_time_t timeout)
+{
+	s3k_word_t signals;
+	while (true) {
+		// Orders the store of the head before the load of the tail, pairs with the fence in s3k_ring_commit.
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		r->peer = __atomic_load_n(&r->buf->tail, __ATOMIC_ACQUIRE);
+		if (r->peer != r->pos)
+			return S3K_SUCCESS;
+		int err = s3k_ipc_arecv_wait(r->ipc, &signals, timeout);
+		if (err != S3K_SUCCESS)
+			return err;
+	}
+}
+
+/**
+ * Copies n bytes, a word at a time if both pointers are word aligned.
+ */
+static inline void _s3k_ring_copy(void *dst, const void *src, s3k_word_t n)
+{
+	unsigned char *d = dst;
+	const unsigned char *s = src;
+	if ((((s3k_word_t)d | (s3k_word_t)s) % sizeof(s3k_word_t)) == 0) {
+		for (; n >= sizeof(s3k_word_t); n -= sizeof(s3k_word_t)) {
+			*(s3k_word_t *)d = *(const s3k_word_t *)s;
+			d += sizeof(s3k_word_t);
+			s += sizeof(s3k_word_t);
+		}
+	}
+	while (n-- > 0)
+		*d++ = *s++;
+}
+
+/**
+ * Copies up to n bytes into the ring and publishes them with one commit.
+ * Returns the number of bytes written.
+ */
+static inline s3k_word_t s3k_ring_write(s3k_ring_t *r, const void *src, s3k_word_t n)
+{
+	s3k_word_t done = 0;
+	void *ptr;
+	// The free space wraps at most once.
+	for (int k = 0; k < 2 && done < n; ++k) {
+		s3k_word_t len = s3k_ring_reserve(r, &ptr, n - done);
+		if (len == 0)
+			break;
+		if (len > n - done)
+			len = n - done;
+		_s3k_ring_copy(ptr, (const unsigned char *)src + done, len);
+		r->pos += len;
+		done += len;
+	}
+	r->pos -= done;
+	s3k_ring_commit(r, done);
+	return done;
+}
+
+/**
+ * Copies up to n bytes out of the ring and frees them.
+ * Returns the number of bytes read.
+ */
+static inline s3k_word_t s3k_ring_read(s3k_ring_t *r, void *dst, s3k_word_t n)
+{
+	s3k_word_t done = 0;
+	const void *ptr;
+	// The data wraps at most once.
+	for (int k = 0; k < 2 && done < n; ++k) {
+		s3k_word_t len = s3k_ring_peek(r, &ptr);
+		if (len == 0)
+			break;
+		if (len > n - done)
+			len = n - done;
+		_s3k_ring_copy((unsigned char *)dst + done, ptr, len);
+		r->pos += len;
+		done += len;
+	}
+	r->pos -= done;
+	s3k_ring_release(r, done);
+	return done;
+}
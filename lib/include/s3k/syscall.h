@@ -1,5 +1,6 @@
 #pragma once
 #include "s3k/types.h"
+#include "s3k/util.h"
 
 enum {
 	S3K_SYSCALL_PID_GET,
@@ -57,6 +58,25 @@ enum {
 	S3K_SYSCALL_IPC_REPLYRECV,
 	S3K_SYSCALL_IPC_ASEND,
 	S3K_SYSCALL_IPC_ARECV,
+	S3K_SYSCALL_LOCK_STAT,
+	S3K_SYSCALL_TSL_GANG_JOIN,
+	S3K_SYSCALL_TSL_GANG_LEAVE,
+	S3K_SYSCALL_BATCH,
+	S3K_SYSCALL_CAP_LIST,
+	S3K_SYSCALL_CAP_INTROSPECT,
+	S3K_SYSCALL_MON_CAP_INTROSPECT,
+	S3K_SYSCALL_MEM_PMP_DEMAND,
+	S3K_SYSCALL_MON_MEM_PMP_DEMAND,
+	S3K_SYSCALL_CAP_RECLAIM,
+	S3K_SYSCALL_CAP_REVOKE_CHILD,
+	S3K_SYSCALL_SPAWN,
+	S3K_SYSCALL_IPC_ADRAIN,
+	S3K_SYSCALL_IPC_ARECV_WAIT,
+	S3K_SYSCALL_IPC_SET_JOIN,
+	S3K_SYSCALL_IPC_SET_LEAVE,
+	S3K_SYSCALL_IPC_SET_WAIT,
+	S3K_SYSCALL_CHAN_CREATE,
+	S3K_SYSCALL_IPC_COPY,
 };
 
 static inline s3k_pid_t s3k_pid_get(void)
@@ -203,17 +223,24 @@ static inline int s3k_mon_derive(s3k_index_t i, s3k_fuel_t csize)
 	return a0;
 }
 
-static inline int s3k_ipc_derive(s3k_index_t i, s3k_fuel_t csize, s3k_ipc_mode_t mode, s3k_ipc_flag_t flag)
+static inline int s3k_ipc_derive_badge(s3k_index_t i, s3k_fuel_t csize, s3k_ipc_mode_t mode, s3k_ipc_flag_t flag,
+				       uint32_t badge)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_DERIVE;
 	register s3k_word_t a1 __asm__("a1") = i;
 	register s3k_word_t a2 __asm__("a2") = csize;
 	register s3k_word_t a3 __asm__("a3") = mode;
 	register s3k_word_t a4 __asm__("a4") = flag;
-	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4));
+	register s3k_word_t a5 __asm__("a5") = badge;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5));
 	return a0;
 }
 
+static inline int s3k_ipc_derive(s3k_index_t i, s3k_fuel_t csize, s3k_ipc_mode_t mode, s3k_ipc_flag_t flag)
+{
+	return s3k_ipc_derive_badge(i, csize, mode, flag, 0);
+}
+
 static inline int s3k_mem_revoke(s3k_index_t i)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MEM_REVOKE;
@@ -302,6 +329,26 @@ static inline int s3k_mem_pmp_set(s3k_index_t i, s3k_pmp_slot_t slot, s3k_mem_pe
 	return a0;
 }
 
+/**
+ * Sets a PMP slot covering [base, base + size) with the cheapest encoding, see s3k_pmp_encode.
+ * A TOR region also occupies slot - 1.
+ */
+static inline int s3k_mem_pmp_map(s3k_index_t i, s3k_pmp_slot_t slot, s3k_mem_perm_t perm, s3k_word_t base,
+				  s3k_word_t size)
+{
+	s3k_pmp_region_t region;
+	if (!s3k_pmp_encode(base, size, &region))
+		return S3K_ERR_INVALID_ARGUMENT;
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MEM_PMP_SET;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = slot;
+	register s3k_word_t a3 __asm__("a3") = perm | region.mode;
+	register s3k_word_t a4 __asm__("a4") = region.addr;
+	register s3k_word_t a5 __asm__("a5") = region.top;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5));
+	return a0;
+}
+
 static inline int s3k_mem_pmp_clear(s3k_index_t i)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MEM_PMP_CLEAR;
@@ -319,6 +366,23 @@ static inline int s3k_tsl_set(s3k_index_t i, bool enabled)
 	return a0;
 }
 
+static inline int s3k_tsl_gang_join(s3k_index_t i, s3k_index_t j)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_TSL_GANG_JOIN;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = j;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2));
+	return a0;
+}
+
+static inline int s3k_tsl_gang_leave(s3k_index_t i)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_TSL_GANG_LEAVE;
+	register s3k_word_t a1 __asm__("a1") = i;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1));
+	return a0;
+}
+
 static inline int s3k_mon_suspend(s3k_index_t i)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MON_SUSPEND;
@@ -534,8 +598,8 @@ static inline int s3k_mon_mon_derive(s3k_index_t i, s3k_index_t j, s3k_fuel_t cs
 	return a0;
 }
 
-static inline int s3k_mon_ipc_derive(s3k_index_t i, s3k_index_t j, s3k_fuel_t csize, s3k_ipc_mode_t mode,
-				     s3k_ipc_flag_t flag)
+static inline int s3k_mon_ipc_derive_badge(s3k_index_t i, s3k_index_t j, s3k_fuel_t csize, s3k_ipc_mode_t mode,
+					   s3k_ipc_flag_t flag, uint32_t badge)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MON_IPC_DERIVE;
 	register s3k_word_t a1 __asm__("a1") = i;
@@ -543,10 +607,17 @@ static inline int s3k_mon_ipc_derive(s3k_index_t i, s3k_index_t j, s3k_fuel_t cs
 	register s3k_word_t a3 __asm__("a3") = csize;
 	register s3k_word_t a4 __asm__("a4") = mode;
 	register s3k_word_t a5 __asm__("a5") = flag;
-	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5));
+	register s3k_word_t a6 __asm__("a6") = badge;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a6));
 	return a0;
 }
 
+static inline int s3k_mon_ipc_derive(s3k_index_t i, s3k_index_t j, s3k_fuel_t csize, s3k_ipc_mode_t mode,
+				     s3k_ipc_flag_t flag)
+{
+	return s3k_mon_ipc_derive_badge(i, j, csize, mode, flag, 0);
+}
+
 static inline int s3k_mon_mem_pmp_get(s3k_index_t i, s3k_index_t j, s3k_pmp_slot_t *slot, s3k_mem_perm_t *perm,
 				      s3k_pmp_addr_t *addr)
 {
@@ -574,6 +645,27 @@ static inline int s3k_mon_mem_pmp_set(s3k_index_t i, s3k_index_t j, s3k_pmp_slot
 	return a0;
 }
 
+/**
+ * Sets a PMP slot of the monitored process covering [base, base + size) with the cheapest encoding.
+ * A TOR region also occupies slot - 1.
+ */
+static inline int s3k_mon_mem_pmp_map(s3k_index_t i, s3k_index_t j, s3k_pmp_slot_t slot, s3k_mem_perm_t perm,
+				      s3k_word_t base, s3k_word_t size)
+{
+	s3k_pmp_region_t region;
+	if (!s3k_pmp_encode(base, size, &region))
+		return S3K_ERR_INVALID_ARGUMENT;
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MON_MEM_PMP_SET;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = j;
+	register s3k_word_t a3 __asm__("a3") = slot;
+	register s3k_word_t a4 __asm__("a4") = perm | region.mode;
+	register s3k_word_t a5 __asm__("a5") = region.addr;
+	register s3k_word_t a6 __asm__("a6") = region.top;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a6));
+	return a0;
+}
+
 static inline int s3k_mon_mem_pmp_clear(s3k_index_t i, s3k_index_t j)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MON_MEM_PMP_CLEAR;
@@ -601,7 +693,8 @@ static inline int s3k_ipc_send(s3k_index_t i, s3k_msg_t *msg)
 	register s3k_word_t a3 __asm__("a3") = msg->data[1];
 	register s3k_word_t a4 __asm__("a4") = msg->capty;
 	register s3k_word_t a5 __asm__("a5") = msg->capidx;
-	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5));
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a7));
 	return a0;
 }
 
@@ -612,12 +705,16 @@ static inline int s3k_ipc_recv(s3k_index_t i, s3k_msg_t *msg)
 	register s3k_word_t a2 __asm__("a2") = msg->servtime;
 	register s3k_word_t a3 __asm__("a3");
 	register s3k_word_t a4 __asm__("a4");
-	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "=r"(a3), "=r"(a4));
+	register s3k_word_t a5 __asm__("a5") = 0;
+	register s3k_word_t a6 __asm__("a6");
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "=r"(a3), "=r"(a4), "=r"(a6) : "r"(a5), "r"(a7));
 	if (a0 == S3K_SUCCESS) {
 		msg->data[0] = a1;
 		msg->data[1] = a2;
 		msg->capty = (s3k_capty_t)a3;
 		msg->capidx = (s3k_index_t)a4;
+		msg->reply = (s3k_index_t)a6;
 	}
 	return a0;
 }
@@ -630,7 +727,8 @@ static inline int s3k_ipc_call(s3k_index_t i, s3k_msg_t *msg)
 	register s3k_word_t a3 __asm__("a3") = msg->data[1];
 	register s3k_word_t a4 __asm__("a4") = msg->capty;
 	register s3k_word_t a5 __asm__("a5") = msg->capidx;
-	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4) : "r"(a5));
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4) : "r"(a5), "r"(a7));
 	if (a0 == S3K_SUCCESS) {
 		msg->data[0] = a1;
 		msg->data[1] = a2;
@@ -648,7 +746,8 @@ static inline int s3k_ipc_reply(s3k_index_t i, s3k_msg_t *msg)
 	register s3k_word_t a3 __asm__("a3") = msg->data[1];
 	register s3k_word_t a4 __asm__("a4") = msg->capty;
 	register s3k_word_t a5 __asm__("a5") = msg->capidx;
-	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5));
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a7));
 	return a0;
 }
 
@@ -661,16 +760,252 @@ static inline int s3k_ipc_replyrecv(s3k_index_t i, s3k_msg_t *msg)
 	register s3k_word_t a4 __asm__("a4") = msg->capty;
 	register s3k_word_t a5 __asm__("a5") = msg->capidx;
 	register s3k_word_t a6 __asm__("a6") = msg->servtime;
-	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4) : "r"(a5), "r"(a6));
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4), "+r"(a6) : "r"(a5), "r"(a7));
+	if (a0 == S3K_SUCCESS) {
+		msg->data[0] = a1;
+		msg->data[1] = a2;
+		msg->capty = (s3k_capty_t)a3;
+		msg->capidx = (s3k_index_t)a4;
+		msg->reply = (s3k_index_t)a6;
+	}
+	return a0;
+}
+
+/**
+ * Like s3k_ipc_send, with all S3K_MSG_WORDS words and S3K_MSG_CAPS capabilities of the message.
+ */
+static inline int s3k_ipc_send_long(s3k_index_t i, s3k_msg_t *msg)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_SEND;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->data[0];
+	register s3k_word_t a3 __asm__("a3") = msg->data[1];
+	register s3k_word_t a4 __asm__("a4") = msg->capty;
+	register s3k_word_t a5 __asm__("a5") = msg->capidx;
+	register s3k_word_t a7 __asm__("a7") = S3K_MSG_WORDS;
+	register s3k_word_t t0 __asm__("t0") = msg->data[2];
+	register s3k_word_t t1 __asm__("t1") = msg->data[3];
+	register s3k_word_t t2 __asm__("t2") = msg->data[4];
+	register s3k_word_t t3 __asm__("t3") = msg->data[5];
+	register s3k_word_t t4 __asm__("t4") = msg->caps[0];
+	register s3k_word_t t5 __asm__("t5") = msg->caps[1];
+	register s3k_word_t t6 __asm__("t6") = msg->caps[2];
+	__asm__ volatile("ecall"
+			 : "+r"(a0)
+			 : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a7), "r"(t0), "r"(t1), "r"(t2), "r"(t3), "r"(t4),
+			   "r"(t5), "r"(t6));
+	return a0;
+}
+
+/**
+ * Like s3k_ipc_recv, with all S3K_MSG_WORDS words and S3K_MSG_CAPS capabilities of the message.
+ */
+static inline int s3k_ipc_recv_long(s3k_index_t i, s3k_msg_t *msg)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_RECV;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->servtime;
+	register s3k_word_t a3 __asm__("a3");
+	register s3k_word_t a4 __asm__("a4");
+	register s3k_word_t a5 __asm__("a5") = 0;
+	register s3k_word_t a6 __asm__("a6");
+	register s3k_word_t a7 __asm__("a7") = S3K_MSG_WORDS;
+	register s3k_word_t t0 __asm__("t0");
+	register s3k_word_t t1 __asm__("t1");
+	register s3k_word_t t2 __asm__("t2");
+	register s3k_word_t t3 __asm__("t3");
+	register s3k_word_t t4 __asm__("t4");
+	register s3k_word_t t5 __asm__("t5");
+	register s3k_word_t t6 __asm__("t6");
+	__asm__ volatile("ecall"
+			 : "+r"(a0), "+r"(a1), "+r"(a2), "=r"(a3), "=r"(a4), "=r"(a6), "=r"(t0), "=r"(t1), "=r"(t2),
+			   "=r"(t3), "=r"(t4), "=r"(t5), "=r"(t6)
+			 : "r"(a5), "r"(a7));
+	if (a0 == S3K_SUCCESS) {
+		msg->data[0] = a1;
+		msg->data[1] = a2;
+		msg->data[2] = t0;
+		msg->data[3] = t1;
+		msg->data[4] = t2;
+		msg->data[5] = t3;
+		msg->caps[0] = t4;
+		msg->caps[1] = t5;
+		msg->caps[2] = t6;
+		msg->capty = (s3k_capty_t)a3;
+		msg->capidx = (s3k_index_t)a4;
+		msg->reply = (s3k_index_t)a6;
+	}
+	return a0;
+}
+
+/**
+ * Like s3k_ipc_call, with all S3K_MSG_WORDS words and S3K_MSG_CAPS capabilities of the call and of the reply.
+ */
+static inline int s3k_ipc_call_long(s3k_index_t i, s3k_msg_t *msg)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_CALL;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->data[0];
+	register s3k_word_t a3 __asm__("a3") = msg->data[1];
+	register s3k_word_t a4 __asm__("a4") = msg->capty;
+	register s3k_word_t a5 __asm__("a5") = msg->capidx;
+	register s3k_word_t a7 __asm__("a7") = S3K_MSG_WORDS;
+	register s3k_word_t t0 __asm__("t0") = msg->data[2];
+	register s3k_word_t t1 __asm__("t1") = msg->data[3];
+	register s3k_word_t t2 __asm__("t2") = msg->data[4];
+	register s3k_word_t t3 __asm__("t3") = msg->data[5];
+	register s3k_word_t t4 __asm__("t4") = msg->caps[0];
+	register s3k_word_t t5 __asm__("t5") = msg->caps[1];
+	register s3k_word_t t6 __asm__("t6") = msg->caps[2];
+	__asm__ volatile("ecall"
+			 : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4), "+r"(t0), "+r"(t1), "+r"(t2), "+r"(t3),
+			   "+r"(t4), "+r"(t5), "+r"(t6)
+			 : "r"(a5), "r"(a7));
+	if (a0 == S3K_SUCCESS) {
+		msg->data[0] = a1;
+		msg->data[1] = a2;
+		msg->data[2] = t0;
+		msg->data[3] = t1;
+		msg->data[4] = t2;
+		msg->data[5] = t3;
+		msg->caps[0] = t4;
+		msg->caps[1] = t5;
+		msg->caps[2] = t6;
+		msg->capty = (s3k_capty_t)a3;
+		msg->capidx = (s3k_index_t)a4;
+	}
+	return a0;
+}
+
+/**
+ * Like s3k_ipc_reply, with all S3K_MSG_WORDS words and S3K_MSG_CAPS capabilities of the message.
+ */
+static inline int s3k_ipc_reply_long(s3k_index_t i, s3k_msg_t *msg)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_REPLY;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->data[0];
+	register s3k_word_t a3 __asm__("a3") = msg->data[1];
+	register s3k_word_t a4 __asm__("a4") = msg->capty;
+	register s3k_word_t a5 __asm__("a5") = msg->capidx;
+	register s3k_word_t a7 __asm__("a7") = S3K_MSG_WORDS;
+	register s3k_word_t t0 __asm__("t0") = msg->data[2];
+	register s3k_word_t t1 __asm__("t1") = msg->data[3];
+	register s3k_word_t t2 __asm__("t2") = msg->data[4];
+	register s3k_word_t t3 __asm__("t3") = msg->data[5];
+	register s3k_word_t t4 __asm__("t4") = msg->caps[0];
+	register s3k_word_t t5 __asm__("t5") = msg->caps[1];
+	register s3k_word_t t6 __asm__("t6") = msg->caps[2];
+	__asm__ volatile("ecall"
+			 : "+r"(a0)
+			 : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a7), "r"(t0), "r"(t1), "r"(t2), "r"(t3), "r"(t4),
+			   "r"(t5), "r"(t6));
+	return a0;
+}
+
+/**
+ * Like s3k_ipc_replyrecv, with all S3K_MSG_WORDS words and S3K_MSG_CAPS capabilities of the reply and of the next message.
+ */
+static inline int s3k_ipc_replyrecv_long(s3k_index_t i, s3k_msg_t *msg)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_REPLYRECV;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->data[0];
+	register s3k_word_t a3 __asm__("a3") = msg->data[1];
+	register s3k_word_t a4 __asm__("a4") = msg->capty;
+	register s3k_word_t a5 __asm__("a5") = msg->capidx;
+	register s3k_word_t a6 __asm__("a6") = msg->servtime;
+	register s3k_word_t a7 __asm__("a7") = S3K_MSG_WORDS;
+	register s3k_word_t t0 __asm__("t0") = msg->data[2];
+	register s3k_word_t t1 __asm__("t1") = msg->data[3];
+	register s3k_word_t t2 __asm__("t2") = msg->data[4];
+	register s3k_word_t t3 __asm__("t3") = msg->data[5];
+	register s3k_word_t t4 __asm__("t4") = msg->caps[0];
+	register s3k_word_t t5 __asm__("t5") = msg->caps[1];
+	register s3k_word_t t6 __asm__("t6") = msg->caps[2];
+	__asm__ volatile("ecall"
+			 : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4), "+r"(a6), "+r"(t0), "+r"(t1), "+r"(t2),
+			   "+r"(t3), "+r"(t4), "+r"(t5), "+r"(t6)
+			 : "r"(a5), "r"(a7));
 	if (a0 == S3K_SUCCESS) {
 		msg->data[0] = a1;
 		msg->data[1] = a2;
+		msg->data[2] = t0;
+		msg->data[3] = t1;
+		msg->data[4] = t2;
+		msg->data[5] = t3;
+		msg->caps[0] = t4;
+		msg->caps[1] = t5;
+		msg->caps[2] = t6;
 		msg->capty = (s3k_capty_t)a3;
 		msg->capidx = (s3k_index_t)a4;
+		msg->reply = (s3k_index_t)a6;
 	}
 	return a0;
 }
 
+/**
+ * Like s3k_ipc_recv, and registers size bytes at buf, in the memory capability mem, as the
+ * destination of an s3k_ipc_copy on the sink while waiting.
+ */
+static inline int s3k_ipc_recv_copy(s3k_index_t i, s3k_msg_t *msg, s3k_index_t mem, void *buf, s3k_word_t size)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_RECV;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->servtime;
+	register s3k_word_t a3 __asm__("a3") = mem;
+	register s3k_word_t a4 __asm__("a4") = (s3k_word_t)buf;
+	register s3k_word_t a5 __asm__("a5") = size;
+	register s3k_word_t a6 __asm__("a6");
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall"
+			 : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4), "=r"(a6)
+			 : "r"(a5), "r"(a7)
+			 : "memory");
+	if (a0 == S3K_SUCCESS) {
+		msg->data[0] = a1;
+		msg->data[1] = a2;
+		msg->capty = (s3k_capty_t)a3;
+		msg->capidx = (s3k_index_t)a4;
+		msg->reply = (s3k_index_t)a6;
+	}
+	return a0;
+}
+
+/**
+ * Copies size bytes at buf, in the memory capability mem, to the destination registered with
+ * s3k_ipc_recv_copy by the receiver of the BSYNC source i, then calls it. The receiver gets the
+ * number of bytes copied and tag as the message. Resumes the copy if the kernel is preempted,
+ * and waits for the reply in msg.
+ */
+static inline int s3k_ipc_copy(s3k_index_t i, s3k_index_t mem, const void *buf, s3k_word_t size, s3k_word_t tag,
+			       s3k_msg_t *msg)
+{
+	s3k_word_t err;
+	do {
+		register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_COPY;
+		register s3k_word_t a1 __asm__("a1") = i;
+		register s3k_word_t a2 __asm__("a2") = tag;
+		register s3k_word_t a3 __asm__("a3") = mem;
+		register s3k_word_t a4 __asm__("a4") = (s3k_word_t)buf;
+		register s3k_word_t a5 __asm__("a5") = size;
+		register s3k_word_t a7 __asm__("a7") = 0;
+		__asm__ volatile("ecall"
+				 : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "+r"(a4)
+				 : "r"(a5), "r"(a7)
+				 : "memory");
+		err = a0;
+		if (err == S3K_SUCCESS) {
+			msg->data[0] = a1;
+			msg->data[1] = a2;
+			msg->capty = (s3k_capty_t)a3;
+			msg->capidx = (s3k_index_t)a4;
+		}
+	} while (err == (s3k_word_t)S3K_ERR_PREEMPTED);
+	return err;
+}
+
 static inline int s3k_ipc_asend(s3k_index_t i, s3k_word_t msg)
 {
 	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_ASEND;
@@ -688,3 +1023,176 @@ static inline int s3k_ipc_arecv(s3k_index_t i, s3k_word_t *msg)
 	*msg = a1;
 	return a0;
 }
+
+static inline int s3k_lock_stat(s3k_hart_t hart, s3k_lock_stat_t *stat)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_LOCK_STAT;
+	register s3k_word_t a1 __asm__("a1") = hart;
+	register s3k_word_t a2 __asm__("a2");
+	register s3k_word_t a3 __asm__("a3");
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "=r"(a2), "=r"(a3));
+	stat->acquired = a1;
+	stat->contended = a2;
+	stat->wait = a3;
+	return a0;
+}
+
+static inline int s3k_batch(s3k_batch_op_t *ops, s3k_word_t count, s3k_word_t *cursor)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_BATCH;
+	register s3k_word_t a1 __asm__("a1") = (s3k_word_t)ops;
+	register s3k_word_t a2 __asm__("a2") = count;
+	register s3k_word_t a3 __asm__("a3") = *cursor;
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1) : "r"(a2), "r"(a3) : "memory");
+	*cursor = a1;
+	return a0;
+}
+
+static inline int s3k_cap_list(s3k_capty_t type, s3k_index_t *buf, s3k_word_t count, s3k_word_t offset)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_CAP_LIST;
+	register s3k_word_t a1 __asm__("a1") = type;
+	register s3k_word_t a2 __asm__("a2") = (s3k_word_t)buf;
+	register s3k_word_t a3 __asm__("a3") = count;
+	register s3k_word_t a4 __asm__("a4") = offset;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4) : "memory");
+	return a0;
+}
+
+static inline int s3k_cap_introspect(s3k_capty_t type, s3k_index_t i, s3k_fuel_t offset, s3k_word_t n, void *buf)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_CAP_INTROSPECT;
+	register s3k_word_t a1 __asm__("a1") = type;
+	register s3k_word_t a2 __asm__("a2") = i;
+	register s3k_word_t a3 __asm__("a3") = offset;
+	register s3k_word_t a4 __asm__("a4") = n;
+	register s3k_word_t a5 __asm__("a5") = (s3k_word_t)buf;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5) : "memory");
+	return a0;
+}
+
+static inline int s3k_mon_cap_introspect(s3k_index_t mon, s3k_capty_t type, s3k_index_t i, s3k_fuel_t offset,
+					 s3k_word_t n, void *buf)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MON_CAP_INTROSPECT;
+	register s3k_word_t a1 __asm__("a1") = mon;
+	register s3k_word_t a2 __asm__("a2") = type;
+	register s3k_word_t a3 __asm__("a3") = i;
+	register s3k_word_t a4 __asm__("a4") = offset;
+	register s3k_word_t a5 __asm__("a5") = n;
+	register s3k_word_t a6 __asm__("a6") = (s3k_word_t)buf;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3), "r"(a4), "r"(a5), "r"(a6) : "memory");
+	return a0;
+}
+
+static inline int s3k_mem_pmp_demand(s3k_index_t i)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MEM_PMP_DEMAND;
+	register s3k_word_t a1 __asm__("a1") = i;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1));
+	return a0;
+}
+
+static inline int s3k_mon_mem_pmp_demand(s3k_index_t i, s3k_index_t j)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_MON_MEM_PMP_DEMAND;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = j;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2));
+	return a0;
+}
+
+static inline int s3k_cap_reclaim(s3k_capty_t type, s3k_index_t i)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_CAP_RECLAIM;
+	register s3k_word_t a1 __asm__("a1") = type;
+	register s3k_word_t a2 __asm__("a2") = i;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2));
+	return a0;
+}
+
+static inline int s3k_cap_revoke_child(s3k_capty_t type, s3k_index_t i, s3k_index_t j)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_CAP_REVOKE_CHILD;
+	register s3k_word_t a1 __asm__("a1") = type;
+	register s3k_word_t a2 __asm__("a2") = i;
+	register s3k_word_t a3 __asm__("a3") = j;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3));
+	return a0;
+}
+
+static inline int s3k_spawn(s3k_index_t mon, s3k_spawn_t *desc)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_SPAWN;
+	register s3k_word_t a1 __asm__("a1") = mon;
+	register s3k_word_t a2 __asm__("a2") = (s3k_word_t)desc;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2) : "memory");
+	return a0;
+}
+
+static inline int s3k_chan_create(s3k_chan_t *desc)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_CHAN_CREATE;
+	register s3k_word_t a1 __asm__("a1") = (s3k_word_t)desc;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1) : "memory");
+	return a0;
+}
+
+static inline int s3k_ipc_adrain(s3k_index_t i, s3k_word_t *buf, s3k_word_t count)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_ADRAIN;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = (s3k_word_t)buf;
+	register s3k_word_t a3 __asm__("a3") = count;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a3) : "memory");
+	return a0;
+}
+
+static inline int s3k_ipc_arecv_wait(s3k_index_t i, s3k_word_t *msg, s3k_time_t timeout)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_ARECV_WAIT;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = timeout;
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1) : "r"(a2));
+	*msg = a1;
+	return a0;
+}
+
+static inline int s3k_ipc_set_join(s3k_index_t i, s3k_index_t j)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_SET_JOIN;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = j;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2));
+	return a0;
+}
+
+static inline int s3k_ipc_set_leave(s3k_index_t i)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_SET_LEAVE;
+	register s3k_word_t a1 __asm__("a1") = i;
+	__asm__ volatile("ecall" : "+r"(a0) : "r"(a1));
+	return a0;
+}
+
+static inline int s3k_ipc_set_wait(s3k_index_t i, s3k_msg_t *msg, s3k_index_t *trigger, s3k_time_t timeout)
+{
+	register s3k_word_t a0 __asm__("a0") = S3K_SYSCALL_IPC_SET_WAIT;
+	register s3k_word_t a1 __asm__("a1") = i;
+	register s3k_word_t a2 __asm__("a2") = msg->servtime;
+	register s3k_word_t a3 __asm__("a3") = timeout;
+	register s3k_word_t a4 __asm__("a4");
+	register s3k_word_t a5 __asm__("a5");
+	register s3k_word_t a6 __asm__("a6");
+	register s3k_word_t a7 __asm__("a7") = 0;
+	__asm__ volatile("ecall" : "+r"(a0), "+r"(a1), "+r"(a2), "+r"(a3), "=r"(a4), "=r"(a5), "=r"(a6) : "r"(a7));
+	if (a0 == S3K_SUCCESS) {
+		msg->data[0] = a1;
+		msg->data[1] = a2;
+		msg->capty = (s3k_capty_t)a3;
+		msg->capidx = (s3k_index_t)a4;
+		msg->reply = (s3k_index_t)a6;
+		*trigger = (s3k_index_t)a5;
+	}
+	return a0;
+}
@@ -30,15 +30,13 @@ typedef s3k_word_t s3k_pmp_addr_t; ///< PMP address type for capabilities.
  * Negative values indicate errors, while zero indicates success.
  */
 typedef enum s3k_err {
-	S3K_SUCCESS = 0,      ///< Operation successful.
-	S3K_ERR_INVARG = -1,  ///< Invalid argument.
-	S3K_ERR_INVACC = -2,  ///< Invalid access.
-	S3K_ERR_INVIDX = -3,  ///< Invalid index.
-	S3K_ERR_INVDRV = -4,  ///< Invalid derivation.
-	S3K_ERR_BADCAP = -5,  ///< Bad capability.
-	S3K_ERR_SLOTUSE = -6, ///< Slot already in use.
-	S3K_ERR_BADADDR = -7, ///< Bad address.
-	S3K_ERR_BADPERM = -8, ///< Bad permissions.
+	S3K_SUCCESS = 0,		///< Operation successful.
+	S3K_ERR_INVALID_ACCESS = -1,	///< Invalid access.
+	S3K_ERR_INVALID_ARGUMENT = -2,	///< Invalid argument.
+	S3K_ERR_INVALID_STATE = -3,	///< Invalid state.
+	S3K_ERR_SLOT_IN_USE = -4,	///< Slot already in use.
+	S3K_ERR_TIMEOUT = -5,		///< Timeout occurred.
+	S3K_ERR_PREEMPTED = -6,		///< Preempted before completion, the operation can be resumed.
 } s3k_err_t;
 
 enum s3k_ipc_mode {
@@ -46,7 +44,8 @@ enum s3k_ipc_mode {
 	S3K_IPC_MODE_USYNC = 1,	 ///< Unidirectional synchronous IPC mode.
 	S3K_IPC_MODE_BSYNC = 2,	 ///< Bidirectional synchronous IPC mode.
 	S3K_IPC_MODE_ASYNC = 3,	 ///< Asynchronous IPC mode.
-	S3K_IPC_MODE_REVOKE = 4, ///< Revoke flag for IPC.
+	S3K_IPC_MODE_NOTIFY = 4, ///< Notification mode, badges are OR-ed into the sink's signal word.
+	S3K_IPC_MODE_REVOKE = 8, ///< Revoke flag for IPC.
 };
 
 enum s3k_ipc_flag {
@@ -55,6 +54,7 @@ enum s3k_ipc_flag {
 	S3K_IPC_FLAG_MEM = 4,	///< Permission to send memory capability.
 	S3K_IPC_FLAG_MON = 8,	///< Permission to send monitor capability.
 	S3K_IPC_FLAG_IPC = 16,	///< Permission to send IPC capability.
+	S3K_IPC_FLAG_QUEUE = 32, ///< Calls to a busy receiver wait in a queue.
 };
 
 /**
@@ -75,6 +75,28 @@ enum mem_perm {
 	S3K_MEM_PERM_RWX = 0x7,	 ///< Read-write-execute permission.
 };
 
+/**
+ * @enum s3k_pmp_mode
+ * @brief PMP address matching modes, combined with the permissions when setting a PMP slot.
+ *
+ * A TOR region also occupies the slot below the given one, which holds its bottom address.
+ */
+enum s3k_pmp_mode {
+	S3K_PMP_MODE_TOR = 0x08,   ///< Top of range, [addr << 2, top << 2).
+	S3K_PMP_MODE_NA4 = 0x10,   ///< Naturally aligned 4-byte region.
+	S3K_PMP_MODE_NAPOT = 0x18, ///< Naturally aligned power-of-two region, also selected by 0.
+};
+
+/**
+ * @struct s3k_pmp_region
+ * @brief Encoded PMP region.
+ */
+typedef struct s3k_pmp_region {
+	s3k_word_t mode;     ///< PMP mode (s3k_pmp_mode).
+	s3k_pmp_addr_t addr; ///< Encoded address, the bottom address for TOR.
+	s3k_pmp_addr_t top;  ///< Top address for TOR, zero otherwise.
+} s3k_pmp_region_t;
+
 typedef enum s3k_capty {
 	S3K_CAPTY_NONE = 0, ///< No capability type.
 	S3K_CAPTY_MEM = 1,  ///< Memory capability type.
@@ -127,21 +149,135 @@ typedef enum s3k_reg_t {
 } s3k_reg_t;
 
 typedef enum s3k_vreg {
-	S3K_VREG_TPC = 0,    ///< Trap Program Counter register.
-	S3K_VREG_TSP = 1,    ///< Trap Stack Pointer register.
-	S3K_VREG_ECAUSE = 2, ///< Exception Cause register.
-	S3K_VREG_EVAL = 3,   ///< Exception Value register.
-	S3K_VREG_EPC = 4,    ///< Exception Program Counter register.
-	S3K_VREG_ESP = 5,    ///< Exception Stack Pointer register.
+	S3K_VREG_TPC = 0,           ///< Trap Program Counter register.
+	S3K_VREG_TSP = 1,           ///< Trap Stack Pointer register.
+	S3K_VREG_ECAUSE = 2,        ///< Exception Cause register.
+	S3K_VREG_EVAL = 3,          ///< Exception Value register.
+	S3K_VREG_EPC = 4,           ///< Exception Program Counter register.
+	S3K_VREG_ESP = 5,           ///< Exception Stack Pointer register.
+	S3K_VREG_PMP_FAULTS = 6,    ///< Access faults handled by installing a capability mapped on demand.
+	S3K_VREG_PMP_EVICTIONS = 7, ///< Capabilities mapped on demand evicted from a PMP slot.
 } s3k_vreg_t;
 
+#define S3K_MSG_WORDS 6 ///< Words of a long synchronous IPC message, short messages have 2.
+#define S3K_MSG_CAPS 4	///< Capabilities of a long synchronous IPC message, short messages have 1.
+
 typedef struct s3k_msg {
-	s3k_word_t data[2]; ///< Data payload (4 words).
-	s3k_capty_t capty;  ///< Capability type.
-	s3k_index_t capidx; ///< Capability index.
-	uint32_t servtime;  ///< Service time.
+	s3k_word_t data[S3K_MSG_WORDS];	   ///< Data payload, short messages use the first 2 words.
+	s3k_capty_t capty;		   ///< Capability type.
+	s3k_index_t capidx;		   ///< Capability index.
+	uint32_t servtime;		   ///< Service time.
+	s3k_index_t reply;		   ///< Reply capability of a received call.
+	s3k_word_t caps[S3K_MSG_CAPS - 1]; ///< Further capabilities of a long message, see s3k_msg_cap.
 } __attribute__((aligned(16))) s3k_msg_t;
 
+/**
+ * @struct s3k_lock_stat
+ * @brief Kernel lock statistics of a hart.
+ */
+typedef struct s3k_lock_stat {
+	uint64_t acquired;  ///< Number of times the lock was acquired.
+	uint64_t contended; ///< Number of acquisitions that found the lock taken.
+	uint64_t wait;	    ///< Cycles spent waiting for the lock.
+} s3k_lock_stat_t;
+
+/**
+ * @struct s3k_batch_op
+ * @brief An operation of a batched system call.
+ *
+ * Laid out like the registers a0-a7 of a system call. Bits 0-7 of args[0] hold the system call
+ * number and bit 8+k replaces args[k] with the result of the previous operation.
+ * The kernel writes the results back in place.
+ */
+typedef struct s3k_batch_op {
+	s3k_word_t args[8]; ///< System call number and arguments, results after execution.
+} s3k_batch_op_t;
+
+#define S3K_SPAWN_MAX_MEM 8 ///< Memory regions of a spawn descriptor.
+#define S3K_SPAWN_MAX_IPC 4 ///< IPC capabilities granted by a spawn descriptor.
+#define S3K_SPAWN_MAX_REG 8 ///< Registers set by a spawn descriptor.
+
+/**
+ * @struct s3k_spawn_mem
+ * @brief A memory region of a spawned process, derived from a memory capability of the caller.
+ */
+typedef struct s3k_spawn_mem {
+	s3k_word_t parent; ///< Index of the caller's memory capability to derive from.
+	s3k_word_t csize;  ///< Fuel of the derived capability.
+	s3k_word_t perm;   ///< Permissions of the derived capability.
+	s3k_word_t base;   ///< Base address of the derived capability.
+	s3k_word_t size;   ///< Size of the derived capability.
+	s3k_word_t slot;   ///< PMP slot of the spawned process, 0 to leave the region unmapped.
+	s3k_word_t mode;   ///< PMP mode and permissions, as for s3k_mem_pmp_set.
+	s3k_word_t addr;   ///< PMP address, the bottom address for TOR.
+	s3k_word_t top;    ///< PMP top address for TOR.
+	s3k_word_t index;  ///< Receives the index of the derived capability.
+} s3k_spawn_mem_t;
+
+/**
+ * @struct s3k_spawn
+ * @brief Descriptor of a process built by s3k_spawn().
+ */
+typedef struct s3k_spawn {
+	s3k_word_t nmem;   ///< Number of memory regions.
+	s3k_word_t nipc;   ///< Number of IPC capabilities to grant.
+	s3k_word_t nreg;   ///< Number of registers to set.
+	s3k_word_t resume; ///< Resume the process if non-zero.
+	s3k_spawn_mem_t mem[S3K_SPAWN_MAX_MEM];
+	s3k_word_t ipc[S3K_SPAWN_MAX_IPC]; ///< Indices of the caller's IPC capabilities, the index is kept when granted.
+
+	struct {
+		s3k_word_t reg;	  ///< Register, see s3k_reg_t.
+		s3k_word_t value; ///< Initial value.
+	} reg[S3K_SPAWN_MAX_REG];
+
+	struct {
+		s3k_word_t parent;  ///< Index of the caller's time slice capability to derive from.
+		s3k_word_t csize;   ///< Fuel of the derived capability, 0 for no time slice.
+		s3k_word_t enabled; ///< Enable the time slots.
+		s3k_word_t size;    ///< Number of time slots.
+		s3k_word_t index;   ///< Receives the index of the derived capability.
+	} tsl;
+} s3k_spawn_t;
+
+/**
+ * @struct s3k_chan_map
+ * @brief A memory capability derived for a channel and its PMP configuration.
+ */
+typedef struct s3k_chan_map {
+	s3k_word_t slot; ///< PMP slot, 0 to leave the capability unmapped.
+	s3k_word_t mode; ///< PMP mode, as for s3k_mem_pmp_set, the permissions are those of the capability.
+	s3k_word_t addr; ///< PMP address, the bottom address for TOR.
+	s3k_word_t top;  ///< PMP top address for TOR.
+	s3k_word_t mem;  ///< Receives the index of the memory capability.
+} s3k_chan_map_t;
+
+/**
+ * @struct s3k_chan_end
+ * @brief One end of a shared-memory channel, a process monitored by the caller.
+ */
+typedef struct s3k_chan_end {
+	s3k_word_t mon;     ///< Index of the caller's monitor capability of the process.
+	s3k_chan_map_t buf; ///< The buffer, read-write for the producer and read-only for the consumer.
+	s3k_word_t ipc;     ///< Receives the index of the notification capability, the source or the sink.
+} s3k_chan_end_t;
+
+/**
+ * @struct s3k_chan
+ * @brief Descriptor of a shared-memory channel established by s3k_chan_create().
+ */
+typedef struct s3k_chan {
+	s3k_word_t mem;      ///< Index of the caller's memory capability to derive the buffer from.
+	s3k_word_t base;     ///< Base address of the buffer.
+	s3k_word_t size;     ///< Size of the buffer.
+	s3k_word_t ipc;      ///< Index of the caller's IPC capability to derive the notification sink from.
+	s3k_word_t badge;    ///< Badge of the producer's notification source.
+	s3k_chan_end_t prod; ///< The producer.
+	s3k_chan_end_t cons; ///< The consumer.
+	s3k_word_t ack_size; ///< Size of the consumer's read-write region at the start of the buffer, 0 for none.
+	s3k_chan_map_t ack;  ///< The region, its PMP slot must be below the consumer's slot of the buffer.
+} s3k_chan_t;
+
 /**
  * @struct s3k_cap_memory
  * @brief Memory capability structure.
@@ -177,6 +313,7 @@ typedef struct s3k_cap_tsl {
 	s3k_time_slot_t mark;  ///< Start of allocated time slots.
 	s3k_time_slot_t begin; ///< Start address of the time slots.
 	s3k_time_slot_t end;   ///< End address of the time slots.
+	uint16_t gang;	       ///< Next member of the gang, the capability itself if not in a gang.
 } __attribute__((aligned(16))) s3k_cap_tsl_t;
 
 typedef struct s3k_cap_mon {
@@ -192,8 +329,9 @@ typedef struct s3k_cap_ipc {
 	s3k_fuel_t csize; ///< Initial cfree allocated to the capability.
 	s3k_ipc_mode_t mode;
 	s3k_ipc_flag_t flag;
-	s3k_index_t sink;
-	s3k_index_t source;
+	uint16_t sink;	 ///< Index of the sink.
+	uint16_t source; ///< Index of the source.
+	uint32_t opt;	 ///< Badge of a notification source, pending signals of a notification sink.
 } __attribute__((aligned(16))) s3k_cap_ipc_t;
 
 _Static_assert(sizeof(s3k_cap_mem_t) == 16, "Memory capability has the wrong size.");
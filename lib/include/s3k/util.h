@@ -16,3 +16,47 @@ static inline s3k_word_t s3k_pmp_napot_decode_size(uint64_t addr)
 {
 	return (((addr + 1) ^ addr) + 1) << 2;
 }
+
+/**
+ * Encodes [base, base + size) with the mode using the fewest PMP slots.
+ * Returns the number of slots used (1 for NA4 and NAPOT, 2 for TOR), or 0 if the range
+ * is empty or not 4-byte aligned.
+ */
+static inline int s3k_pmp_encode(s3k_word_t base, s3k_word_t size, s3k_pmp_region_t *region)
+{
+	if (size == 0 || base % 4 != 0 || size % 4 != 0 || base + size < base)
+		return 0;
+	region->top = 0;
+	if (size == 4) {
+		region->mode = S3K_PMP_MODE_NA4;
+		region->addr = base >> 2;
+		return 1;
+	}
+	if ((size & (size - 1)) == 0 && base % size == 0) {
+		region->mode = S3K_PMP_MODE_NAPOT;
+		region->addr = s3k_pmp_napot_encode(base, size);
+		return 1;
+	}
+	region->mode = S3K_PMP_MODE_TOR;
+	region->addr = base >> 2;
+	region->top = (base + size) >> 2;
+	return 2;
+}
+
+/**
+ * Packs a capability for the caps of a long message, 0 if none.
+ */
+static inline s3k_word_t s3k_msg_cap(s3k_capty_t capty, s3k_index_t i)
+{
+	return (capty == S3K_CAPTY_NONE) ? 0 : (capty | (s3k_word_t)i << 8);
+}
+
+static inline s3k_capty_t s3k_msg_cap_type(s3k_word_t cap)
+{
+	return (s3k_capty_t)(cap & 0xFF);
+}
+
+static inline s3k_index_t s3k_msg_cap_index(s3k_word_t cap)
+{
+	return (s3k_index_t)(cap >> 8);
+}
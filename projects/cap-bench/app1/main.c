@@ -0,0 +1,121 @@
+#include "s3k.h"
+
+#include <stdio.h>
+
+#define MEMORY_FUEL 256 // Must match nmemoryfuel
+#define REPS 64		// Repetitions of each measurement
+
+// The loads measured on a subtable of n children of memory capability 0.
+enum load {
+	LOAD_REVOKE,	 // Derive n children, then revoke them all, streams the subtable
+	LOAD_RECLAIM,	 // Derive n children, delete them, then reclaim their fuel, streams the owners
+	LOAD_LIST,	 // Enumerate the memory capabilities of this process
+	LOAD_INTROSPECT, // Copy out the subtable
+	NLOADS,
+};
+
+static const char *const load_names[NLOADS] = {"revoke", "reclaim", "list", "introspect"};
+static const int sizes[] = {16, 64, MEMORY_FUEL - 1};
+
+static s3k_index_t index_buf[MEMORY_FUEL];
+static s3k_cap_mem_t cap_buf[MEMORY_FUEL];
+
+// Read the cycle counter using the RISC-V rdcycle instruction
+static inline uint64_t rdcycle(void)
+{
+	s3k_word_t cycle;
+	__asm__ volatile("rdcycle %0" : "=r"(cycle));
+	return cycle;
+}
+
+// Derive n children of capability 0 covering its whole region, the kernel reports the size in the end field
+static int derive(const s3k_cap_mem_t *root, int n)
+{
+	for (int k = 0; k < n; ++k) {
+		int err = s3k_mem_derive(0, 1, S3K_MEM_PERM_RW, root->begin, root->end);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+// Revoke the children of capability 0, resuming after preemptions
+static int revoke(void)
+{
+	int err;
+	do {
+		err = s3k_mem_revoke(0);
+	} while (err == S3K_ERR_PREEMPTED);
+	return err;
+}
+
+// Run one load on n children and return the cycles spent on the measured operation
+static int64_t run_load(int type, const s3k_cap_mem_t *root, int n)
+{
+	uint64_t start, end;
+	int err = 0;
+
+	switch (type) {
+	case LOAD_REVOKE:
+		start = rdcycle();
+		err = derive(root, n);
+		if (!err)
+			err = revoke();
+		end = rdcycle();
+		return err ? err : (int64_t)(end - start);
+	case LOAD_RECLAIM:
+		start = rdcycle();
+		err = derive(root, n);
+		// Children are placed downwards from the end of the subtable, reclaim then scans all of them.
+		for (int k = 0; k < n && !err; ++k)
+			err = s3k_mem_delete(MEMORY_FUEL - 1 - k);
+		if (!err)
+			err = s3k_cap_reclaim(S3K_CAPTY_MEM, 0);
+		end = rdcycle();
+		return err < 0 ? err : (int64_t)(end - start);
+	case LOAD_LIST:
+	case LOAD_INTROSPECT:
+		err = derive(root, n);
+		start = rdcycle();
+		if (!err && type == LOAD_LIST)
+			err = s3k_cap_list(S3K_CAPTY_MEM, index_buf, MEMORY_FUEL, 0);
+		if (!err && type == LOAD_INTROSPECT)
+			err = s3k_cap_introspect(S3K_CAPTY_MEM, 0, 1, n, cap_buf);
+		end = rdcycle();
+		if (err >= 0)
+			err = revoke();
+		return err < 0 ? err : (int64_t)(end - start);
+	}
+	return 0;
+}
+
+int main(void)
+{
+	printf("Capability table benchmark (%s)\n", CAPSOA ? "soa" : "aos");
+
+	s3k_cap_mem_t root;
+	if (s3k_mem_introspect(0, 0, &root)) {
+		printf("Failed to read memory capability 0\n");
+		return 1;
+	}
+
+	printf("load,layout,n,cycles\n");
+	for (int type = 0; type < NLOADS; ++type) {
+		for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+			int64_t total = 0;
+			for (int rep = 0; rep < REPS; ++rep) {
+				int64_t cycles = run_load(type, &root, sizes[s]);
+				if (cycles < 0) {
+					printf("%s failed with %d\n", load_names[type], (int)cycles);
+					return 1;
+				}
+				total += cycles;
+			}
+			printf("%s,%s,%d,%ld\n", load_names[type], CAPSOA ? "soa" : "aos", sizes[s],
+			       (long)(total / REPS));
+		}
+	}
+
+	s3k_mon_suspend(0);
+	s3k_sync();
+}
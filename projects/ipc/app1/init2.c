@@ -4,21 +4,13 @@
 
 extern char __uart_base[]; // UART base address
 
-void mem_init(s3k_word_t mon_idx, s3k_word_t idx, s3k_word_t slot, s3k_word_t cfree, s3k_word_t perm, s3k_word_t base,
-	      s3k_word_t size)
+static void mem_init(s3k_batch_t *b, s3k_word_t mon_idx, s3k_word_t idx, s3k_word_t slot, s3k_word_t cfree,
+		     s3k_word_t perm, s3k_word_t base, s3k_word_t size)
 {
-	idx = s3k_mon_mem_derive(mon_idx, idx, cfree, perm, base, size);
-	if (idx < 0) {
-		printf("Failed to derive memory capability %lx\n", base);
-		return;
-	}
-
-	s3k_word_t addr = s3k_pmp_napot_encode(base, size);
-	int err = s3k_mon_mem_pmp_set(mon_idx, idx, slot, perm, addr);
-	if (err < 0) {
-		printf("Failed to set PMP for derived memory %lx, err=%d\n", base, err);
-		return;
-	}
+	s3k_batch_mon_mem_derive(b, mon_idx, idx, cfree, perm, base, size);
+	// Use the index of the derived capability.
+	s3k_batch_mon_mem_pmp_set(b, mon_idx, 0, slot, perm, s3k_pmp_napot_encode(base, size));
+	s3k_batch_link(b, 2);
 }
 
 void app2_init(void)
@@ -27,23 +19,31 @@ void app2_init(void)
 	int ram_idx = 0;   // RAM index
 	int uart_idx = 16; // UART index
 
+	s3k_batch_op_t ops[5];
+	s3k_batch_t batch;
+	s3k_batch_init(&batch, ops, 5);
+
 	// RAM configuration
 	s3k_word_t ram_base = 0x80020000;
 	s3k_word_t ram_size = 0x10000;
 	s3k_word_t ram_perm = S3K_MEM_PERM_RWX; // Read/Write/Execute permissions
 	s3k_word_t ram_fuel = 1;
 	s3k_word_t ram_slot = 1;
-	mem_init(mon_idx, ram_idx, ram_slot, ram_fuel, ram_perm, ram_base, ram_size);
+	mem_init(&batch, mon_idx, ram_idx, ram_slot, ram_fuel, ram_perm, ram_base, ram_size);
 
 	s3k_word_t uart_base = (s3k_word_t)__uart_base;
 	s3k_word_t uart_size = 0x20;
 	s3k_word_t uart_perm = S3K_MEM_PERM_RW; // Read/Write permissions
 	s3k_word_t uart_fuel = 1;
 	s3k_word_t uart_slot = 2;
-	mem_init(mon_idx, uart_idx, uart_slot, uart_fuel, uart_perm, uart_base, uart_size);
+	mem_init(&batch, mon_idx, uart_idx, uart_slot, uart_fuel, uart_perm, uart_base, uart_size);
 
-	if (s3k_mon_reg_set(mon_idx, S3K_REG_PC, ram_base) != 0) {
-		printf("Failed to set program counter to RAM start\n");
+	s3k_batch_mon_reg_set(&batch, mon_idx, S3K_REG_PC, ram_base);
+
+	// Configure app2 with a single system call.
+	int err = s3k_batch_run(&batch);
+	if (err < 0) {
+		printf("Failed to initialize app2 at operation %ld, err=%d\n", batch.cursor, err);
 		return;
 	}
 }
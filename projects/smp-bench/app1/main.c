@@ -0,0 +1,177 @@
+#include "s3k.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define TIME_FUEL 32	 // Must match ntimefuel
+#define MONITOR_FUEL 8	 // Must match nmonitorfuel
+
+#define APP_BASE 0x80000000 // Start of this application's RAM (see platform/*.ld)
+#define APP_SIZE 0x10000    // Size of this application's RAM
+
+#define WINDOW 1000000	    // Measurement window in rdtime ticks (100 ms at 10 MHz)
+#define STACK_SIZE 2048	    // Stack size of each worker
+
+// The loads each hart runs during a measurement window.
+enum load {
+	LOAD_SYSCALL, // Cheapest syscall, measures trap entry/exit and lock hand-over
+	LOAD_IPC,     // Asynchronous send and receive on a private channel
+	LOAD_SCHED,   // Yield the remainder of the time slot, measures the scheduler
+	NLOADS,
+};
+
+static const char *const load_names[NLOADS] = {"syscall", "ipc", "sched"};
+
+// State shared between the coordinator (hart 0) and the workers (hart 1..NHARTS-1).
+static volatile int epoch;
+static volatile int load;
+static volatile uint64_t deadline;
+static volatile int done[NHARTS];
+static volatile uint64_t ops[NHARTS];
+
+static char stacks[NHARTS][STACK_SIZE] __attribute__((aligned(16)));
+
+// Read the real-time counter using the RISC-V rdtime instruction
+static inline uint64_t rdtime(void)
+{
+	s3k_word_t time;
+	__asm__ volatile("rdtime %0" : "=r"(time));
+	return time;
+}
+
+// Run one load until the deadline and return the number of completed operations
+static uint64_t run_load(int type, s3k_index_t sink, s3k_index_t source)
+{
+	uint64_t end = deadline;
+	uint64_t n = 0;
+	s3k_word_t msg;
+
+	while (rdtime() < end) {
+		switch (type) {
+		case LOAD_SYSCALL:
+			s3k_pid_get();
+			break;
+		case LOAD_IPC:
+			s3k_ipc_asend(source, n);
+			s3k_ipc_arecv(sink, &msg);
+			break;
+		case LOAD_SCHED:
+			s3k_sync();
+			break;
+		}
+		n++;
+	}
+	return n;
+}
+
+// Entry point of the workers, a0 = hart, a1 = sink, a2 = source
+void worker(s3k_word_t hart, s3k_index_t sink, s3k_index_t source)
+{
+	int seen = 0;
+	while (1) {
+		// Wait for the coordinator to start the next epoch
+		while (__atomic_load_n(&epoch, __ATOMIC_ACQUIRE) == seen)
+			;
+		seen = epoch;
+		ops[hart] = run_load(load, sink, source);
+		__atomic_store_n(&done[hart], seen, __ATOMIC_RELEASE);
+	}
+}
+
+// Derive an asynchronous channel, returns the sink and the source
+static bool channel_init(s3k_index_t *sink, s3k_index_t *source)
+{
+	int i = s3k_ipc_derive(0, 2, S3K_IPC_MODE_ASYNC, 0);
+	if (i < 0)
+		return false;
+	int j = s3k_ipc_derive(i, 1, S3K_IPC_MODE_ASYNC, 0);
+	if (j < 0)
+		return false;
+	*sink = i;
+	*source = j;
+	return true;
+}
+
+// Start a worker process (pid hart+1) on the given hart
+static bool worker_init(s3k_word_t hart, s3k_word_t gp)
+{
+	s3k_index_t mon = hart * MONITOR_FUEL;
+	s3k_index_t tsl = hart * TIME_FUEL;
+	s3k_index_t sink, source;
+
+	// Share this application's RAM with the worker
+	int mem = s3k_mon_mem_derive(mon, 0, 1, S3K_MEM_PERM_RWX, APP_BASE, APP_SIZE);
+	if (mem < 0)
+		return false;
+	if (s3k_mon_mem_pmp_set(mon, mem, 1, S3K_MEM_PERM_RWX, s3k_pmp_napot_encode(APP_BASE, APP_SIZE)))
+		return false;
+
+	// Give the worker a private channel for the IPC load
+	if (!channel_init(&sink, &source))
+		return false;
+	if (s3k_mon_ipc_grant(mon, sink) || s3k_mon_ipc_grant(mon, source))
+		return false;
+
+	s3k_mon_reg_set(mon, S3K_REG_PC, (s3k_word_t)worker);
+	s3k_mon_reg_set(mon, S3K_REG_SP, (s3k_word_t)&stacks[hart][STACK_SIZE]);
+	s3k_mon_reg_set(mon, S3K_REG_GP, gp);
+	s3k_mon_reg_set(mon, S3K_REG_A0, hart);
+	s3k_mon_reg_set(mon, S3K_REG_A1, sink);
+	s3k_mon_reg_set(mon, S3K_REG_A2, source);
+
+	// Hand over the whole time root of the hart
+	if (s3k_mon_tsl_grant(mon, tsl) || s3k_mon_tsl_set(mon, tsl, true))
+		return false;
+	return s3k_mon_resume(mon) == 0;
+}
+
+int main(void)
+{
+	s3k_sync();
+	printf("SMP Benchmark (%d harts)\n", NHARTS);
+
+	s3k_word_t gp;
+	__asm__ volatile("mv %0, gp" : "=r"(gp));
+
+	for (int hart = 1; hart < NHARTS; ++hart) {
+		if (!worker_init(hart, gp)) {
+			printf("Failed to start worker on hart %d\n", hart);
+			return 1;
+		}
+	}
+
+	s3k_index_t sink, source;
+	if (!channel_init(&sink, &source)) {
+		printf("Failed to derive channel\n");
+		return 1;
+	}
+
+	s3k_lock_stat_t before[NHARTS], after[NHARTS];
+	printf("load,hart,ops,lock_acquired,lock_contended,lock_wait\n");
+	for (int type = 0; type < NLOADS; ++type) {
+		for (int hart = 0; hart < NHARTS; ++hart)
+			s3k_lock_stat(hart, &before[hart]);
+
+		load = type;
+		deadline = rdtime() + WINDOW;
+		__atomic_store_n(&epoch, epoch + 1, __ATOMIC_RELEASE);
+
+		ops[0] = run_load(type, sink, source);
+		for (int hart = 1; hart < NHARTS; ++hart) {
+			while (__atomic_load_n(&done[hart], __ATOMIC_ACQUIRE) != epoch)
+				;
+		}
+
+		for (int hart = 0; hart < NHARTS; ++hart)
+			s3k_lock_stat(hart, &after[hart]);
+
+		for (int hart = 0; hart < NHARTS; ++hart) {
+			printf("%s,%d,%ld,%ld,%ld,%ld\n", load_names[type], hart, ops[hart],
+			       after[hart].acquired - before[hart].acquired,
+			       after[hart].contended - before[hart].contended, after[hart].wait - before[hart].wait);
+		}
+	}
+
+	s3k_mon_suspend(0);
+	s3k_sync();
+}